@@ -0,0 +1,61 @@
+/*-----------------------------------------------------------------------/
+/  Host (POSIX) stand-in for <arch/rc2014/diskio.h>                      /
+/-----------------------------------------------------------------------/
+/  Lets the FatFs module and the host examples in this directory build
+/  with gcc or clang on a PC. It has to be force included (-include) so
+/  that the integer types below are used instead of those in ffinteger.h,
+/  which are sized for the Z80 compilers.
+*/
+
+#ifndef __DISKIO_H__
+#define __DISKIO_H__
+
+#include <stdint.h>
+#include <pthread.h>        /* FF_SYNC_t is pthread_mutex_t* on the host */
+
+typedef int             INT;
+typedef unsigned int    UINT;
+typedef unsigned char   BYTE;
+typedef short           SHORT;
+typedef unsigned short  WORD;
+typedef unsigned short  WCHAR;
+typedef int32_t         LONG;
+typedef uint32_t        DWORD;
+typedef uint64_t        QWORD;
+
+/* Status of Disk Functions */
+typedef BYTE    DSTATUS;
+
+/* Results of Disk Functions */
+typedef enum {
+    RES_OK = 0,     /* 0: Successful */
+    RES_ERROR,      /* 1: R/W Error */
+    RES_WRPRT,      /* 2: Write Protected */
+    RES_NOTRDY,     /* 3: Not Ready */
+    RES_PARERR      /* 4: Invalid Parameter */
+} DRESULT;
+
+/* Disk Status Bits (DSTATUS) */
+#define STA_NOINIT      0x01    /* Drive not initialized */
+#define STA_NODISK      0x02    /* No medium in the drive */
+#define STA_PROTECT     0x04    /* Write protected */
+
+/* Generic command (Used by FatFs) */
+#define CTRL_SYNC           0   /* Complete pending write process */
+#define GET_SECTOR_COUNT    1   /* Get media size */
+#define GET_SECTOR_SIZE     2   /* Get sector size */
+#define GET_BLOCK_SIZE      3   /* Get erase block size */
+#define CTRL_TRIM           4   /* Inform device that the data on the block of sectors is no longer used */
+
+DSTATUS disk_initialize (BYTE pdrv);
+DSTATUS disk_status (BYTE pdrv);
+DRESULT disk_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+DRESULT disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
+
+/* Host disk images (diskio_host.c) */
+int disk_attach (BYTE pdrv, const char* path, DWORD nsect);
+extern unsigned int disk_latency_us;    /* Delay added to each read and write to model a slow drive */
+extern unsigned long disk_nread, disk_nwrite;   /* Number of read and write commands */
+
+#endif
@@ -0,0 +1,267 @@
+/*----------------------------------------------------------------------/
+/ Overlap of disk transfers and processing at FF_USE_ASYNC (host)       /
+/-----------------------------------------------------------------------/
+/ A 4 MiB file is read and written in 16 KiB chunks, a cluster each, on
+/ a drive with 2 ms access latency, with a processing step of the given
+/ time per chunk (checksum or fill, then a busy wait modelling a decoder).
+/ The chunks are moved with f_read()/f_write(), where the processing
+/ waits for the transfer, and with f_read_async()/f_write_async() into a
+/ pair of buffers, where the next chunk is in flight on the device thread
+/ of diskio_host.c while the current one is processed. f_async_poll() is
+/ called between the slices of the processing to keep the transfer
+/ going. Each row reports the MiB/s of both ways and the share of the
+/ transfer time hidden behind the processing.
+/
+/ Build on a Linux host from a copy of ../../source in src/ whose ffconf.h
+/ has FF_USE_MKFS 1 and FF_USE_ASYNC 1.
+/
+/ cc -O2 -D__RC2014 -I. -Isrc -include arch/rc2014/diskio.h async_overlap.c
+/    diskio_host.c src/ff.c src/ffunicode.c -lpthread -o async_overlap
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ff.h"
+
+#define FSZ         (4096 * 1024L)  /* Size of the file */
+#define CHUNK       16384           /* Size of each chunk */
+#define NSECT       140000          /* Size of the drive */
+#define NSLICE      8               /* Slices of the processing of a chunk */
+
+static FATFS FatFs;
+static BYTE bufs[2][CHUNK];
+static unsigned int work_us;
+static int nerror;
+
+
+static
+double now_us (void)
+{
+    struct timespec ts;
+
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static
+DWORD process (         /* Checksum of the slice */
+    FIL* fp,            /* File object to poll (0:None) */
+    const BYTE* b,
+    UINT n
+)
+{
+    DWORD sum = 0;
+    double t;
+    UINT i, s;
+
+
+    for (s = 0; s < NSLICE; s++) {
+        t = now_us() + (double)work_us / NSLICE;
+        for (i = s * n / NSLICE; i < (s + 1) * n / NSLICE; i++) sum = sum * 31 + b[i];
+        while (now_us() < t) ;    /* Decoding */
+        if (fp && f_async_busy(fp) && f_async_poll(fp) != FR_OK) nerror++;
+    }
+    return sum;
+}
+
+
+static
+void generate (         /* Fill chunk k of the file */
+    FIL* fp,            /* File object to poll (0:None) */
+    BYTE* b,
+    long k
+)
+{
+    double t;
+    UINT i, s;
+
+
+    for (s = 0; s < NSLICE; s++) {
+        t = now_us() + (double)work_us / NSLICE;
+        for (i = s * CHUNK / NSLICE; i < (s + 1) * CHUNK / NSLICE; i++) b[i] = (BYTE)(k * 7 + i);
+        while (now_us() < t) ;    /* Encoding */
+        if (fp && f_async_busy(fp) && f_async_poll(fp) != FR_OK) nerror++;
+    }
+}
+
+
+static
+int settle (            /* Wait for end of the transfer of the file */
+    FIL* fp
+)
+{
+    while (f_async_busy(fp)) {
+        if (f_async_poll(fp) != FR_OK) return -1;
+    }
+    return 0;
+}
+
+
+static
+double read_sync (
+    DWORD* sum
+)
+{
+    FIL fil;
+    UINT br;
+    double t;
+
+
+    *sum = 0;
+    if (f_open(&fil, "data", FA_READ) != FR_OK) { nerror++; return 1; }
+    t = now_us();
+    for (;;) {
+        if (f_read(&fil, bufs[0], CHUNK, &br) != FR_OK) { nerror++; break; }
+        if (br == 0) break;
+        *sum += process(0, bufs[0], br);
+    }
+    t = now_us() - t;
+    f_close(&fil);
+    return t;
+}
+
+
+static
+double read_async (
+    DWORD* sum
+)
+{
+    FIL fil;
+    UINT br[2];
+    double t;
+    int k = 0;
+
+
+    *sum = 0;
+    if (f_open(&fil, "data", FA_READ) != FR_OK) { nerror++; return 1; }
+    t = now_us();
+    if (f_read_async(&fil, bufs[0], CHUNK, &br[0]) != FR_OK || settle(&fil)) { nerror++; br[0] = 0; }
+    while (br[k]) {
+        br[k ^ 1] = 0;
+        if (br[k] == CHUNK && f_read_async(&fil, bufs[k ^ 1], CHUNK, &br[k ^ 1]) != FR_OK) { nerror++; break; }
+        *sum += process(&fil, bufs[k], br[k]);    /* Next chunk is read meanwhile */
+        if (settle(&fil)) { nerror++; break; }
+        k ^= 1;
+    }
+    t = now_us() - t;
+    f_close(&fil);
+    return t;
+}
+
+
+static
+double write_sync (void)
+{
+    FIL fil;
+    UINT bw;
+    long k;
+    double t;
+
+
+    if (f_open(&fil, "out", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) { nerror++; return 1; }
+    t = now_us();
+    for (k = 0; k < FSZ / CHUNK; k++) {
+        generate(0, bufs[0], k);
+        if (f_write(&fil, bufs[0], CHUNK, &bw) != FR_OK || bw != CHUNK) { nerror++; break; }
+    }
+    t = now_us() - t;
+    f_close(&fil);
+    return t;
+}
+
+
+static
+double write_async (void)
+{
+    FIL fil;
+    UINT bw[2];
+    long k;
+    double t;
+
+
+    if (f_open(&fil, "out", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) { nerror++; return 1; }
+    t = now_us();
+    for (k = 0; k < FSZ / CHUNK; k++) {
+        generate(&fil, bufs[k & 1], k);        /* Previous chunk is written meanwhile */
+        if (settle(&fil) || (k > 0 && bw[(k - 1) & 1] != CHUNK)) { nerror++; break; }
+        if (f_write_async(&fil, bufs[k & 1], CHUNK, &bw[k & 1]) != FR_OK) { nerror++; break; }
+    }
+    if (settle(&fil) || bw[(k - 1) & 1] != CHUNK) nerror++;
+    t = now_us() - t;
+    f_close(&fil);
+    return t;
+}
+
+
+static
+int check_out (void)    /* 0:Written data is correct */
+{
+    FIL fil;
+    UINT br, i;
+    long k;
+
+
+    if (f_open(&fil, "out", FA_READ) != FR_OK) return -1;
+    for (k = 0; k < FSZ / CHUNK; k++) {
+        if (f_read(&fil, bufs[0], CHUNK, &br) != FR_OK || br != CHUNK) break;
+        for (i = 0; i < CHUNK && bufs[0][i] == (BYTE)(k * 7 + i); i++) ;
+        if (i < CHUNK) break;
+    }
+    f_close(&fil);
+    return (k == FSZ / CHUNK) ? 0 : -1;
+}
+
+
+int main (void)
+{
+    static BYTE work[4096];
+    static const unsigned int tw[] = { 0, 1000, 2000, 4000, 8000 };
+    FIL fil;
+    FSIZE_t x;
+    DWORD s0, s1;
+    double ts, ta, tx;
+    UINT bw;
+    int i;
+
+
+    if (disk_attach(0, "async_overlap.img", NSECT) != 0) { puts("disk_attach failed"); return 1; }
+    if (f_mkfs("", FM_ANY, CHUNK, work, sizeof work) != FR_OK) { puts("f_mkfs failed"); return 1; }
+    if (f_mount(&FatFs, "", 1) != FR_OK) { puts("f_mount failed"); return 1; }
+    if (f_open(&fil, "data", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return 1;
+    for (x = 0; x < FSZ; x += sizeof work) {
+        for (bw = 0; bw < sizeof work; bw++) work[bw] = (BYTE)((x + bw) * 13 + (x + bw) / 4096);
+        if (f_write(&fil, work, sizeof work, &bw) != FR_OK) return 1;
+    }
+    f_close(&fil);
+
+    disk_latency_us = 2000;
+    tx = 0;
+    for (i = 0; i < 2; i++) {            /* Transfer time alone */
+        work_us = 0;
+        tx = i ? write_sync() : read_sync(&s0);
+        printf("%s transfers alone: %5.2f MiB/s\n", i ? "write" : "read ", FSZ / tx * 1e6 / 1048576);
+        for (bw = 0; bw < sizeof tw / sizeof tw[0]; bw++) {
+            work_us = tw[bw];
+            if (i) {
+                ts = write_sync();
+                ta = write_async();
+                if (check_out() != 0) { puts("write_async: bad data"); nerror++; }
+            } else {
+                ts = read_sync(&s0);
+                ta = read_async(&s1);
+                if (s0 != s1) { puts("read_async: bad data"); nerror++; }
+            }
+            printf("%s %5u us/chunk: sync %5.2f MiB/s, async %5.2f MiB/s, %3.0f%% of transfer time hidden\n",
+                i ? "write" : "read ", work_us, FSZ / ts * 1e6 / 1048576, FSZ / ta * 1e6 / 1048576, (ts - ta) / tx * 100);
+        }
+    }
+    f_mount(NULL, "", 0);
+
+    printf("%s\n", nerror ? "FAILED" : "OK");
+    return nerror ? 1 : 0;
+}
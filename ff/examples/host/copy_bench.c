@@ -0,0 +1,156 @@
+/*----------------------------------------------------------------------/
+/ Copy throughput of f_copy() within and across volumes (host)          /
+/-----------------------------------------------------------------------/
+/ Files of 256 KiB and 4 MiB are copied to another file on the same
+/ volume and to the second volume, on drives with 200 us access latency
+/ and volumes of 4 KiB clusters. They are copied with a user level loop
+/ of f_read()/f_write() with a 512 byte and a 16 KiB buffer, and with
+/ f_copy() with a 16 KiB work buffer, which allocates the destination in
+/ a contiguous block at FF_USE_EXPAND and moves the data in runs of up
+/ to the work buffer size. Each row reports the MiB/s and the read and
+/ write commands, with the directory and FAT accesses. The copies are
+/ checked against the source, and the f_copy() ones also for the
+/ timestamp and the attributes.
+/
+/ Build on a Linux host from a copy of ../../source in src/ whose ffconf.h
+/ has FF_USE_MKFS 1, FF_VOLUMES 2, FF_USE_COPY 1 and FF_USE_EXPAND 1.
+/
+/ cc -O2 -D__RC2014 -I. -Isrc -include arch/rc2014/diskio.h copy_bench.c
+/    diskio_host.c src/ff.c src/ffunicode.c -lpthread -o copy_bench
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ff.h"
+
+#define NSECT       140000          /* Size of each drive */
+
+static FATFS FatFs[2];
+static BYTE work[16384];
+static int nerror;
+
+
+static
+double now_us (void)
+{
+    struct timespec ts;
+
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static
+int copy_loop (         /* 0:Ok */
+    const char* src,
+    const char* dst,
+    UINT bsize          /* Size of the buffer */
+)
+{
+    FIL fs, fd;
+    UINT br, bw;
+    FRESULT res;
+
+
+    if (f_open(&fs, src, FA_READ) != FR_OK) return -1;
+    if (f_open(&fd, dst, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) { f_close(&fs); return -1; }
+    do {
+        res = f_read(&fs, work, bsize, &br);
+        if (res == FR_OK && br > 0) res = f_write(&fd, work, br, &bw);
+    } while (res == FR_OK && br == bsize && bw == br);
+    f_close(&fs);
+    if (f_close(&fd) != FR_OK) res = FR_DISK_ERR;
+    return (res == FR_OK) ? 0 : -1;
+}
+
+
+static
+int compare (           /* 0:Same content */
+    const char* a,
+    const char* b
+)
+{
+    static BYTE buf[2][4096];
+    FIL fa, fb;
+    UINT ra, rb;
+    int r = -1;
+
+
+    if (f_open(&fa, a, FA_READ) != FR_OK) return -1;
+    if (f_open(&fb, b, FA_READ) == FR_OK) {
+        for (;;) {
+            if (f_read(&fa, buf[0], sizeof buf[0], &ra) != FR_OK || f_read(&fb, buf[1], sizeof buf[1], &rb) != FR_OK) break;
+            if (ra != rb || memcmp(buf[0], buf[1], ra) != 0) break;
+            if (ra == 0) { r = 0; break; }
+        }
+        f_close(&fb);
+    }
+    f_close(&fa);
+    return r;
+}
+
+
+int main (void)
+{
+    static const char* const name[] = { "f_read/f_write 512 B", "f_read/f_write 16 KiB", "f_copy 16 KiB" };
+    static const FSIZE_t fsz[] = { 256 * 1024L, 4096 * 1024L };
+    FILINFO fs, fd;
+    FIL fil;
+    FSIZE_t x;
+    unsigned long nr, nw;
+    char src[8];
+    const char *dst;
+    double t;
+    UINT i, bw;
+    int n, v, w, r;
+
+
+    if (disk_attach(0, "copy_bench0.img", NSECT) != 0 || disk_attach(1, "copy_bench1.img", NSECT) != 0) { puts("disk_attach failed"); return 1; }
+    if (f_mkfs("0:", FM_ANY, 4096, work, sizeof work) != FR_OK || f_mkfs("1:", FM_ANY, 4096, work, sizeof work) != FR_OK) { puts("f_mkfs failed"); return 1; }
+    if (f_mount(&FatFs[0], "0:", 1) != FR_OK || f_mount(&FatFs[1], "1:", 1) != FR_OK) { puts("f_mount failed"); return 1; }
+    for (n = 0; n < 2; n++) {
+        sprintf(src, "0:src%d", n);
+        if (f_open(&fil, src, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return 1;
+        for (x = 0; x < fsz[n]; x += sizeof work) {
+            for (i = 0; i < sizeof work; i++) work[i] = (BYTE)((x + i) * 5 + (x + i) / 1000 + n);
+            if (f_write(&fil, work, sizeof work, &bw) != FR_OK) return 1;
+        }
+        f_close(&fil);
+        fs.fdate = (WORD)((2001 - 1980) << 9 | 2 << 5 | 3); fs.ftime = (WORD)(12 << 11);    /* An old timestamp to be copied */
+        if (f_utime(src, &fs) != FR_OK || f_chmod(src, AM_ARC | AM_RDO, AM_ARC | AM_RDO) != FR_OK) return 1;
+    }
+
+    disk_latency_us = 200;
+    for (n = 0; n < 2; n++) {
+        sprintf(src, "0:src%d", n);
+        for (v = 0; v < 2; v++) {
+            dst = v ? "1:dst" : "0:dst";
+            for (w = 0; w < 3; w++) {
+                f_chmod(dst, 0, AM_RDO);
+                f_unlink(dst);
+                nr = disk_nread; nw = disk_nwrite;
+                t = now_us();
+                r = (w < 2) ? copy_loop(src, dst, w ? sizeof work : 512) : (f_copy(src, dst, work, sizeof work) == FR_OK ? 0 : -1);
+                t = now_us() - t;
+                nr = disk_nread - nr; nw = disk_nwrite - nw;
+                if (r != 0) { printf("%s failed\n", name[w]); nerror++; continue; }
+                if (compare(src, dst) != 0) { printf("%s: bad data\n", name[w]); nerror++; }
+                if (w == 2 && (f_stat(src, &fs) != FR_OK || f_stat(dst, &fd) != FR_OK
+                    || fs.fdate != fd.fdate || fs.ftime != fd.ftime || fs.fattrib != fd.fattrib)) {
+                    printf("%s: timestamp or attributes not copied\n", name[w]); nerror++;
+                }
+                printf("%4lu KiB %s volume, %-21s %6.2f MiB/s, %5lu reads, %5lu writes\n",
+                    (unsigned long)(fsz[n] / 1024), v ? "other" : "same ", name[w], fsz[n] / t * 1e6 / 1048576, nr, nw);
+            }
+        }
+    }
+    f_mount(NULL, "0:", 0);
+    f_mount(NULL, "1:", 0);
+
+    printf("%s\n", nerror ? "FAILED" : "OK");
+    return nerror ? 1 : 0;
+}
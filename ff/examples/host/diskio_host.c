@@ -0,0 +1,186 @@
+/*-----------------------------------------------------------------------/
+/  Disk I/O on image files for the host (POSIX) examples                 /
+/-----------------------------------------------------------------------/
+/  Each physical drive is a file of 512-byte sectors attached with
+/  disk_attach(). The transfers use pread()/pwrite(), so the drive can be
+/  called from several threads at a time as FF_FS_REENTRANT = 2 requires.
+/  The commands are counted in disk_nread and disk_nwrite. At FF_USE_ASYNC,
+/  disk_submit() hands the transfer to a device thread of the drive, which
+/  takes the same latency as disk_read()/disk_write(), and disk_poll()
+/  reports its end, so the caller can work meanwhile.
+*/
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ff.h"
+
+#define NDRIVES     4
+
+static int img_fd[NDRIVES] = { -1, -1, -1, -1 };
+static DWORD img_nsect[NDRIVES];
+
+unsigned int disk_latency_us;
+unsigned long disk_nread, disk_nwrite;
+
+
+int disk_attach (       /* 0:Ok, -1:Error */
+    BYTE pdrv,          /* Physical drive number */
+    const char* path,   /* Image file, created or truncated */
+    DWORD nsect         /* Number of sectors */
+)
+{
+    if (pdrv >= NDRIVES) return -1;
+    img_fd[pdrv] = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (img_fd[pdrv] < 0) return -1;
+    if (ftruncate(img_fd[pdrv], (off_t)nsect * 512) != 0) return -1;
+    img_nsect[pdrv] = nsect;
+    return 0;
+}
+
+
+DSTATUS disk_initialize (BYTE pdrv)
+{
+    return (pdrv < NDRIVES && img_fd[pdrv] >= 0) ? 0 : STA_NOINIT;
+}
+
+
+DSTATUS disk_status (BYTE pdrv)
+{
+    return (pdrv < NDRIVES && img_fd[pdrv] >= 0) ? 0 : STA_NOINIT;
+}
+
+
+DRESULT disk_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+    __atomic_fetch_add(&disk_nread, 1, __ATOMIC_RELAXED);
+    if (disk_latency_us) usleep(disk_latency_us);
+    if (pread(img_fd[pdrv], buff, (size_t)count * 512, (off_t)sector * 512) != (ssize_t)count * 512) return RES_ERROR;
+    return RES_OK;
+}
+
+
+DRESULT disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+    __atomic_fetch_add(&disk_nwrite, 1, __ATOMIC_RELAXED);
+    if (disk_latency_us) usleep(disk_latency_us);
+    if (pwrite(img_fd[pdrv], buff, (size_t)count * 512, (off_t)sector * 512) != (ssize_t)count * 512) return RES_ERROR;
+    return RES_OK;
+}
+
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff)
+{
+    switch (cmd) {
+    case CTRL_SYNC :
+        return RES_OK;
+    case GET_SECTOR_COUNT :
+        *(DWORD*)buff = img_nsect[pdrv];
+        return RES_OK;
+    case GET_SECTOR_SIZE :
+        *(WORD*)buff = 512;
+        return RES_OK;
+    case GET_BLOCK_SIZE :
+        *(DWORD*)buff = 1;
+        return RES_OK;
+    }
+    return RES_PARERR;
+}
+
+
+#if FF_USE_ASYNC
+static pthread_mutex_t dev_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dev_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t dev_thread[NDRIVES];
+
+static struct {         /* Transfer handed to the device thread of each drive */
+    BYTE* buff;
+    DWORD sector;
+    UINT count;
+    BYTE wr;
+    int state;          /* 0:Completed, 1:In progress, -1:Failed, 2:No device thread */
+} dev_req[NDRIVES] = { {0, 0, 0, 0, 2}, {0, 0, 0, 0, 2}, {0, 0, 0, 0, 2}, {0, 0, 0, 0, 2} };
+
+
+static
+void* device (
+    void* arg
+)
+{
+    BYTE pdrv = (BYTE)(long)arg;
+    DRESULT res;
+
+
+    pthread_mutex_lock(&dev_mutex);
+    for (;;) {
+        while (dev_req[pdrv].state != 1) pthread_cond_wait(&dev_cond, &dev_mutex);
+        pthread_mutex_unlock(&dev_mutex);
+        if (dev_req[pdrv].wr) {
+            res = disk_write(pdrv, dev_req[pdrv].buff, dev_req[pdrv].sector, dev_req[pdrv].count);
+        } else {
+            res = disk_read(pdrv, dev_req[pdrv].buff, dev_req[pdrv].sector, dev_req[pdrv].count);
+        }
+        pthread_mutex_lock(&dev_mutex);
+        dev_req[pdrv].state = (res == RES_OK) ? 0 : -1;
+    }
+    return 0;
+}
+
+
+int disk_submit (       /* 0:Started, 1:Error */
+    BYTE pdrv,          /* Physical drive number */
+    BYTE* buff,         /* Data buffer (kept until the end of the transfer) */
+    DWORD sector,       /* Start sector */
+    UINT count,         /* Number of sectors */
+    BYTE wr             /* 0:Read, 1:Write */
+)
+{
+    int err = 0;
+
+
+    if (pdrv >= NDRIVES || img_fd[pdrv] < 0) return 1;
+    pthread_mutex_lock(&dev_mutex);
+    if (dev_req[pdrv].state == 2) {     /* Start the device thread at the first transfer */
+        if (pthread_create(&dev_thread[pdrv], NULL, device, (void*)(long)pdrv) != 0) err = 1;
+    } else if (dev_req[pdrv].state == 1) {  /* Only one transfer in flight */
+        err = 1;
+    }
+    if (!err) {
+        dev_req[pdrv].buff = buff; dev_req[pdrv].sector = sector; dev_req[pdrv].count = count; dev_req[pdrv].wr = wr;
+        dev_req[pdrv].state = 1;
+        pthread_cond_broadcast(&dev_cond);
+    }
+    pthread_mutex_unlock(&dev_mutex);
+    return err;
+}
+
+
+int disk_poll (         /* 0:Completed, 1:In progress, -1:Failed */
+    BYTE pdrv           /* Physical drive number */
+)
+{
+    int st;
+
+
+    if (pdrv >= NDRIVES) return -1;
+    pthread_mutex_lock(&dev_mutex);
+    st = dev_req[pdrv].state;
+    pthread_mutex_unlock(&dev_mutex);
+    return (st == 2) ? 0 : st;
+}
+#endif
+
+
+#if !FF_FS_READONLY && !FF_FS_NORTC
+DWORD get_fattime (void)
+{
+    time_t t = time(NULL);
+    struct tm *tm = localtime(&t);
+
+    return (DWORD)(tm->tm_year - 80) << 25 | (DWORD)(tm->tm_mon + 1) << 21 | (DWORD)tm->tm_mday << 16
+        | (DWORD)tm->tm_hour << 11 | (DWORD)tm->tm_min << 5 | (DWORD)tm->tm_sec >> 1;
+}
+#endif
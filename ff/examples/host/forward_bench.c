@@ -0,0 +1,138 @@
+/*----------------------------------------------------------------------/
+/ Sustained streaming rate of f_forward()/f_forward_buf() (host)        /
+/-----------------------------------------------------------------------/
+/ A 4 MiB file on a volume of 16 KiB clusters is streamed to a sink that
+/ takes the given time per byte (a busy wait modelling a serial port or
+/ an audio DAC), on a drive with 500 us access latency. f_forward() hands
+/ the sink a sector at a time, read with a single sector read each.
+/ f_forward_buf() with a bounce buffer of 2 KiB to 32 KiB reads runs of
+/ whole sectors with a multi-sector read and hands them over in a chunk.
+/ At FF_USE_ASYNC, the buffer is used as two halves and the next run is
+/ read on the device thread of diskio_host.c while the sink is taking
+/ the current one. Each row reports the sustained MiB/s and the number
+/ of read commands. Build it with FF_USE_ASYNC 0 and 1 to compare.
+/
+/ Build on a Linux host from a copy of ../../source in src/ whose ffconf.h
+/ has FF_USE_MKFS 1, FF_USE_FORWARD 1 and FF_USE_ASYNC 1 (or 0).
+/
+/ cc -O2 -D__RC2014 -I. -Isrc -include arch/rc2014/diskio.h forward_bench.c
+/    diskio_host.c src/ff.c src/ffunicode.c -lpthread -o forward_bench
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ff.h"
+
+#define FSZ         (4096 * 1024L)  /* Size of the file */
+#define NSECT       140000          /* Size of the drive */
+
+static FATFS FatFs;
+static DWORD sum;
+static double ns_per_byte;
+static int nerror;
+
+
+static
+double now_us (void)
+{
+    struct timespec ts;
+
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static
+UINT sink (             /* Stream function (0:Busy or no data taken) */
+    const BYTE* p,      /* Data to take (0:Sense call) */
+    UINT n              /* Number of bytes */
+)
+{
+    double t;
+    UINT i;
+
+
+    if (n == 0) return 1;    /* Always ready */
+    t = now_us() + n * ns_per_byte / 1e3;
+    for (i = 0; i < n; i++) sum = sum * 31 + p[i];
+    while (now_us() < t) ;    /* Sending */
+    return n;
+}
+
+
+static
+double stream (         /* Time to stream the file (0:Error) */
+    BYTE* buff,         /* Bounce buffer (0:f_forward) */
+    UINT bsize
+)
+{
+    FIL fil;
+    UINT bf;
+    FRESULT res;
+    double t;
+
+
+    sum = 0;
+    if (f_open(&fil, "stream", FA_READ) != FR_OK) return 0;
+    t = now_us();
+    do {
+        res = buff ? f_forward_buf(&fil, sink, 65536, &bf, buff, bsize) : f_forward(&fil, sink, 65536, &bf);
+    } while (res == FR_OK && bf > 0);
+    t = now_us() - t;
+    f_close(&fil);
+    return (res == FR_OK) ? t : 0;
+}
+
+
+int main (void)
+{
+    static BYTE work[32768];
+    static const double tb[] = { 0, 50, 200 };
+    static const UINT bs[] = { 0, 2048, 8192, 32768 };
+    FIL fil;
+    FSIZE_t x;
+    DWORD ref = 0;
+    unsigned long ncmd;
+    double t;
+    UINT i, bw;
+    int s, b;
+
+
+    if (disk_attach(0, "forward_bench.img", NSECT) != 0) { puts("disk_attach failed"); return 1; }
+    if (f_mkfs("", FM_ANY, 16384, work, sizeof work) != FR_OK) { puts("f_mkfs failed"); return 1; }
+    if (f_mount(&FatFs, "", 1) != FR_OK) { puts("f_mount failed"); return 1; }
+    if (f_open(&fil, "stream", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return 1;
+    for (x = 0; x < FSZ; x += sizeof work) {
+        for (i = 0; i < sizeof work; i++) {
+            work[i] = (BYTE)((x + i) * 7 + (x + i) / 512);
+            ref = ref * 31 + work[i];
+        }
+        if (f_write(&fil, work, sizeof work, &bw) != FR_OK) return 1;
+    }
+    f_close(&fil);
+
+    disk_latency_us = 500;
+    printf("FF_USE_ASYNC = %d\n", FF_USE_ASYNC);
+    for (s = 0; s < (int)(sizeof tb / sizeof tb[0]); s++) {
+        ns_per_byte = tb[s];
+        for (b = 0; b < (int)(sizeof bs / sizeof bs[0]); b++) {
+            ncmd = disk_nread;
+            t = stream(bs[b] ? work : 0, bs[b]);
+            ncmd = disk_nread - ncmd;
+            if (t == 0 || sum != ref) { puts("streaming failed"); nerror++; continue; }
+            if (bs[b]) {
+                printf("sink %3.0f ns/byte, f_forward_buf %2u KiB: %6.2f MiB/s, %5lu commands\n", tb[s], bs[b] / 1024, FSZ / t * 1e6 / 1048576, ncmd);
+            } else {
+                printf("sink %3.0f ns/byte, f_forward:          %6.2f MiB/s, %5lu commands\n", tb[s], FSZ / t * 1e6 / 1048576, ncmd);
+            }
+        }
+    }
+    f_mount(NULL, "", 0);
+
+    printf("%s\n", nerror ? "FAILED" : "OK");
+    return nerror ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+/*----------------------------------------------------------------------/
+/ Time to load overlays with f_load() (host)                            /
+/-----------------------------------------------------------------------/
+/ Overlays of 16, 32 and 48 KiB (plus 100 bytes, so that the last sector
+/ is partial) are loaded into memory on a volume of 2 KiB clusters and a
+/ drive with 1 ms access latency. They are loaded with f_open() and a
+/ loop of 512 byte f_read() calls, with f_open() and a single f_read() of
+/ the whole file, and with f_load(). Each overlay is stored once in one
+/ contiguous block and once fragmented, with its clusters interleaved
+/ with those of another file. Each row reports the time to load and the
+/ number of read commands including the directory and FAT reads.
+/
+/ Build on a Linux host from a copy of ../../source in src/ whose ffconf.h
+/ has FF_USE_MKFS 1 and FF_USE_LOAD 1.
+/
+/ cc -O2 -D__RC2014 -I. -Isrc -include arch/rc2014/diskio.h load_bench.c
+/    diskio_host.c src/ff.c src/ffunicode.c -lpthread -o load_bench
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ff.h"
+
+#define NSECT       40000           /* Size of the drive */
+#define CLSZ        2048            /* Cluster size */
+
+static FATFS FatFs;
+static BYTE mem[48 * 1024 + 100];
+static int nerror;
+
+
+static
+double now_us (void)
+{
+    struct timespec ts;
+
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static
+BYTE pattern (          /* Expected content of overlay n at offset x */
+    int n,
+    UINT x
+)
+{
+    return (BYTE)(n * 41 + x * 3 + x / 512);
+}
+
+
+static
+int load_loop (         /* 0:Ok */
+    const char* path,
+    UINT* len
+)
+{
+    FIL fil;
+    UINT br;
+
+
+    *len = 0;
+    if (f_open(&fil, path, FA_READ) != FR_OK) return -1;
+    do {
+        if (f_read(&fil, mem + *len, 512, &br) != FR_OK) return -1;
+        *len += br;
+    } while (br == 512);
+    return (f_close(&fil) == FR_OK) ? 0 : -1;
+}
+
+
+static
+int load_read (         /* 0:Ok */
+    const char* path,
+    UINT* len
+)
+{
+    FIL fil;
+
+
+    if (f_open(&fil, path, FA_READ) != FR_OK) return -1;
+    if (f_read(&fil, mem, sizeof mem, len) != FR_OK) return -1;
+    return (f_close(&fil) == FR_OK) ? 0 : -1;
+}
+
+
+static
+int load_load (         /* 0:Ok */
+    const char* path,
+    UINT* len
+)
+{
+    return (f_load(path, mem, sizeof mem, len) == FR_OK) ? 0 : -1;
+}
+
+
+int main (void)
+{
+    static BYTE work[CLSZ];
+    static const char* const name[] = { "f_read 512 B loop", "f_read whole file", "f_load" };
+    int (* const func[])(const char*, UINT*) = { load_loop, load_read, load_load };
+    FIL fo, ff;
+    UINT sz, x, i, bw, len;
+    unsigned long ncmd;
+    char path[16];
+    double t;
+    int k, n, w;
+
+
+    if (disk_attach(0, "load_bench.img", NSECT) != 0) { puts("disk_attach failed"); return 1; }
+    if (f_mkfs("", FM_FAT, CLSZ, work, sizeof work) != FR_OK) { puts("f_mkfs failed"); return 1; }
+    if (f_mount(&FatFs, "", 1) != FR_OK) { puts("f_mount failed"); return 1; }
+    for (n = 0; n < 3; n++) {
+        sz = (n + 1) * 16 * 1024 + 100;
+        for (k = 0; k < 2; k++) {    /* Contiguous, fragmented */
+            sprintf(path, "ovl%d%c.bin", n, k ? 'f' : 'c');
+            if (f_open(&fo, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return 1;
+            if (k && f_open(&ff, "filler", FA_WRITE | FA_OPEN_APPEND) != FR_OK) return 1;
+            for (x = 0; x < sz; x += bw) {
+                for (i = 0; i < CLSZ; i++) work[i] = pattern(n, x + i);
+                if (f_write(&fo, work, (sz - x < CLSZ) ? sz - x : CLSZ, &bw) != FR_OK) return 1;
+                if (k && f_write(&ff, work, CLSZ, &i) != FR_OK) return 1;    /* Interleave the clusters */
+            }
+            f_close(&fo);
+            if (k) f_close(&ff);
+        }
+    }
+
+    disk_latency_us = 1000;
+    for (n = 0; n < 3; n++) {
+        sz = (n + 1) * 16 * 1024 + 100;
+        for (k = 0; k < 2; k++) {
+            sprintf(path, "ovl%d%c.bin", n, k ? 'f' : 'c');
+            for (w = 0; w < 3; w++) {
+                memset(mem, 0, sizeof mem);
+                f_mount(&FatFs, "", 1);    /* Start with no FAT or directory sector cached */
+                ncmd = disk_nread;
+                t = now_us();
+                if (func[w](path, &len) != 0) { printf("%s failed\n", name[w]); nerror++; continue; }
+                t = now_us() - t;
+                ncmd = disk_nread - ncmd;
+                for (x = 0; x < sz && mem[x] == pattern(n, x); x++) ;
+                if (len != sz || x < sz) { printf("%s: bad data\n", name[w]); nerror++; }
+                printf("%2u KiB %s, %-18s %6.1f ms, %3lu commands\n", sz / 1024, k ? "fragmented" : "contiguous", name[w], t / 1e3, ncmd);
+            }
+        }
+    }
+    f_mount(NULL, "", 0);
+
+    printf("%s\n", nerror ? "FAILED" : "OK");
+    return nerror ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+/*----------------------------------------------------------------------/
+/ In-place record decoding with f_peek()/f_consume() (host)             /
+/-----------------------------------------------------------------------/
+/ A 2 MiB file of variable length records (a length byte and 0 to 255
+/ bytes of payload) is decoded four ways: f_read() of each header and
+/ payload into a record buffer, f_read() of 512 byte or 4 KiB blocks
+/ decoded from the block buffer, and f_peek()/f_consume() decoding each
+/ sector in place in the sector cache of the file object. The decoder is
+/ a byte stream state machine, so the records split between sectors need
+/ no copy. Each row reports the nanoseconds per byte and the disk read
+/ commands, first with no access latency, then with 100 us per command.
+/ The 512 byte f_read() issues the same single sector reads as f_peek(),
+/ so the difference between them is the copy into the caller's buffer.
+/ The 4 KiB f_read() copies too but reads several sectors per command.
+/
+/ Build on a Linux host from a copy of ../../source in src/ whose ffconf.h
+/ has FF_USE_MKFS 1.
+/
+/ cc -O2 -D__RC2014 -I. -Isrc -include arch/rc2014/diskio.h peek_bench.c
+/    diskio_host.c src/ff.c src/ffunicode.c -lpthread -o peek_bench
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ff.h"
+
+#define FSZ         (2048 * 1024L)  /* Size of the file */
+#define NSECT       140000          /* Size of the drive */
+#define NRUN        3               /* Runs of each way, the best one is taken */
+
+static FATFS FatFs;
+static int nerror;
+
+typedef struct {
+    UINT left;          /* Payload bytes left in the current record (0:Header is next) */
+    DWORD nrec;         /* Number of records decoded */
+    DWORD sum;          /* Checksum of the payload */
+} DECODER;
+
+
+static
+double now_us (void)
+{
+    struct timespec ts;
+
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static
+void decode (           /* Decode a span of the record stream */
+    DECODER* dc,
+    const BYTE* p,
+    UINT n
+)
+{
+    UINT c;
+
+
+    while (n) {
+        if (dc->left == 0) {            /* Header */
+            dc->left = *p++; n--;
+            dc->nrec++;
+            continue;
+        }
+        c = (dc->left < n) ? dc->left : n;    /* Payload in the span */
+        n -= c; dc->left -= c;
+        while (c--) dc->sum = dc->sum * 31 + *p++;
+    }
+}
+
+
+static
+void decode_rec (       /* Decode a whole record read into a buffer */
+    DECODER* dc,
+    const BYTE* p,
+    UINT n
+)
+{
+    dc->nrec++;
+    while (n--) dc->sum = dc->sum * 31 + *p++;
+}
+
+
+static
+int by_record (DECODER* dc)
+{
+    static BYTE rec[256];
+    FIL fil;
+    BYTE hdr;
+    UINT br;
+
+
+    if (f_open(&fil, "records", FA_READ) != FR_OK) return -1;
+    for (;;) {
+        if (f_read(&fil, &hdr, 1, &br) != FR_OK) return -1;
+        if (br == 0) break;
+        if (f_read(&fil, rec, hdr, &br) != FR_OK || br != hdr) return -1;
+        decode_rec(dc, rec, br);
+    }
+    return (f_close(&fil) == FR_OK) ? 0 : -1;
+}
+
+
+static
+int by_block (
+    DECODER* dc,
+    UINT bsize          /* Size of the block */
+)
+{
+    static BYTE buf[4096];
+    FIL fil;
+    UINT br;
+
+
+    if (f_open(&fil, "records", FA_READ) != FR_OK) return -1;
+    for (;;) {
+        if (f_read(&fil, buf, bsize, &br) != FR_OK) return -1;
+        if (br == 0) break;
+        decode(dc, buf, br);
+    }
+    return (f_close(&fil) == FR_OK) ? 0 : -1;
+}
+
+
+static
+int by_sector (DECODER* dc)
+{
+    return by_block(dc, 512);
+}
+
+
+static
+int by_4k (DECODER* dc)
+{
+    return by_block(dc, 4096);
+}
+
+
+static
+int by_peek (DECODER* dc)
+{
+    const BYTE *p;
+    FIL fil;
+    UINT n;
+
+
+    if (f_open(&fil, "records", FA_READ) != FR_OK) return -1;
+    for (;;) {
+        if (f_peek(&fil, &p, &n) != FR_OK) return -1;
+        if (n == 0) break;
+        decode(dc, p, n);
+        if (f_consume(&fil, n) != FR_OK) return -1;
+    }
+    return (f_close(&fil) == FR_OK) ? 0 : -1;
+}
+
+
+int main (void)
+{
+    static BYTE work[4096];
+    static const char* const name[] = { "f_read per record", "f_read 512 B blocks", "f_read 4 KiB blocks", "f_peek/f_consume" };
+    int (* const func[])(DECODER*) = { by_record, by_sector, by_4k, by_peek };
+    DECODER dc, ref;
+    FIL fil;
+    FSIZE_t x;
+    unsigned long ncmd;
+    unsigned int seed = 1;
+    double t, best;
+    UINT i, bw;
+    int lat, w, r;
+
+
+    if (disk_attach(0, "peek_bench.img", NSECT) != 0) { puts("disk_attach failed"); return 1; }
+    if (f_mkfs("", FM_ANY, 4096, work, sizeof work) != FR_OK) { puts("f_mkfs failed"); return 1; }
+    if (f_mount(&FatFs, "", 1) != FR_OK) { puts("f_mount failed"); return 1; }
+    if (f_open(&fil, "records", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return 1;
+    memset(&ref, 0, sizeof ref);
+    for (x = 0; x < FSZ; x += sizeof work) {
+        for (i = 0; i < sizeof work; i++) {
+            if (ref.left == 0) {        /* Header, the last record ends at the end of file */
+                ref.left = (UINT)rand_r(&seed) % 256;
+                if (ref.left > FSZ - x - i - 1) ref.left = (UINT)(FSZ - x - i - 1);
+                work[i] = (BYTE)ref.left;
+                ref.nrec++;
+            } else {
+                work[i] = (BYTE)rand_r(&seed);
+                ref.sum = ref.sum * 31 + work[i];
+                ref.left--;
+            }
+        }
+        if (f_write(&fil, work, sizeof work, &bw) != FR_OK) return 1;
+    }
+    f_close(&fil);
+
+    for (lat = 0; lat <= 100; lat += 100) {
+        disk_latency_us = lat;
+        printf("%3d us per command\n", lat);
+        for (w = 0; w < 4; w++) {
+            best = 0; ncmd = 0;
+            for (r = 0; r < NRUN; r++) {
+                memset(&dc, 0, sizeof dc);
+                ncmd = disk_nread;
+                t = now_us();
+                if (func[w](&dc) != 0) { printf("%s failed\n", name[w]); nerror++; break; }
+                t = now_us() - t;
+                ncmd = disk_nread - ncmd;
+                if (dc.nrec != ref.nrec || dc.sum != ref.sum) { printf("%s: bad data\n", name[w]); nerror++; break; }
+                if (r == 0 || t < best) best = t;
+            }
+            printf("  %-20s %7.2f ns/byte, %5lu commands\n", name[w], best * 1e3 / FSZ, ncmd);
+        }
+    }
+    f_mount(NULL, "", 0);
+
+    printf("%s\n", nerror ? "FAILED" : "OK");
+    return nerror ? 1 : 0;
+}
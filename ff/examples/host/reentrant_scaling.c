@@ -0,0 +1,171 @@
+/*----------------------------------------------------------------------/
+/ Scaling of concurrent file reads at FF_FS_REENTRANT = 2 (host)        /
+/-----------------------------------------------------------------------/
+/ Random reads from 8 files by 1 to 8 threads, with and without another
+/ thread appending to a file, on a drive with 100 us access latency. At
+/ FF_FS_REENTRANT = 2 the data transfers of the threads overlap, so the
+/ reads per second scale with the number of threads. At 1 they do not.
+/ At FF_FS_STCACHE, f_media_changed() is called at the end while the
+/ readers are running, which must make them fail with FR_INVALID_OBJECT
+/ also when it happens during a data transfer.
+/
+/ Build on a Linux host from a copy of ../../source in src/ whose ffconf.h
+/ has FF_USE_MKFS 1, FF_FS_REENTRANT 2 (or 1 to compare), FF_FS_TIMEOUT 1000,
+/ FF_SYNC_t pthread_mutex_t*, FF_FS_CONTIG 1 and optionally FF_FS_STCACHE 16.
+/ Without FF_FS_CONTIG, following the cluster chain reads the FAT under the
+/ volume lock on each seek and the reads scale much less.
+/
+/ cc -O2 -D__RC2014 -I. -Isrc -include arch/rc2014/diskio.h reentrant_scaling.c
+/    diskio_host.c sync_posix.c src/ff.c src/ffunicode.c -lpthread -o reentrant_scaling
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "ff.h"
+
+#define NFILES      8
+#define FSZ         (128 * 1024L)   /* Size of each file */
+#define NSECT       140000          /* Size of the drive */
+
+static FATFS FatFs;
+static volatile int stop, changed;
+static long nreads[8];
+static UINT chunk;
+static int nerror;
+
+
+static
+BYTE pattern (          /* Expected content of file n at offset x */
+    int n,
+    FSIZE_t x
+)
+{
+    return (BYTE)(n * 37 + (x / 500) * 11 + x);
+}
+
+
+static
+void* reader (
+    void* arg
+)
+{
+    static BYTE bufs[8][4096];
+    long id = (long)arg;
+    BYTE *b = bufs[id];
+    unsigned int seed = (unsigned int)id + 1;
+    FSIZE_t ofs;
+    FIL fil;
+    UINT br, i;
+    FRESULT res;
+    char path[8];
+
+
+    sprintf(path, "f%ld", id % NFILES);
+    if (f_open(&fil, path, FA_READ) != FR_OK) { nerror++; return 0; }
+    while (!stop) {
+        ofs = (FSIZE_t)(rand_r(&seed) % (FSZ / chunk)) * chunk;
+        res = f_lseek(&fil, ofs);
+        if (res == FR_OK) res = f_read(&fil, b, chunk, &br);
+        if (res != FR_OK) {
+            if (changed && res == FR_INVALID_OBJECT) break;    /* Dismounted by f_media_changed() */
+            printf("reader %ld: error %d\n", id, res);
+            nerror++;
+            break;
+        }
+        for (i = 0; i < br; i++) {
+            if (b[i] != pattern(id % NFILES, ofs + i)) { printf("reader %ld: bad data at %lu\n", id, (unsigned long)(ofs + i)); nerror++; break; }
+        }
+        nreads[id]++;
+    }
+    f_close(&fil);
+    return 0;
+}
+
+
+static
+void* writer (
+    void* arg
+)
+{
+    static BYTE b[3000];
+    long n = 0;
+    FIL fil;
+    UINT bw;
+
+
+    memset(b, 0x55, sizeof b);
+    if (f_open(&fil, "log", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) { nerror++; return 0; }
+    while (!stop) {
+        if (f_write(&fil, b, sizeof b, &bw) != FR_OK || bw != sizeof b) { nerror++; break; }
+        if (++n % 10 == 0 && f_sync(&fil) != FR_OK) { nerror++; break; }
+    }
+    f_close(&fil);
+    *(long*)arg = n;
+    return 0;
+}
+
+
+int main (void)
+{
+    static BYTE work[4096];
+    pthread_t th[8], tw;
+    FILINFO fno;
+    FIL fil;
+    FSIZE_t x;
+    long total, nwritten;
+    int i, nt, wr;
+    UINT bw;
+    char path[8];
+
+
+    if (disk_attach(0, "reentrant_scaling.img", NSECT) != 0) { puts("disk_attach failed"); return 1; }
+    if (f_mkfs("", FM_FAT32, 512, work, sizeof work) != FR_OK) { puts("f_mkfs failed"); return 1; }
+    if (f_mount(&FatFs, "", 1) != FR_OK) { puts("f_mount failed"); return 1; }
+    for (i = 0; i < NFILES; i++) {
+        sprintf(path, "f%d", i);
+        if (f_open(&fil, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return 1;
+        for (x = 0; x < FSZ; x += sizeof work) {
+            for (bw = 0; bw < sizeof work; bw++) work[bw] = pattern(i, x + bw);
+            if (f_write(&fil, work, sizeof work, &bw) != FR_OK) return 1;
+        }
+        f_close(&fil);
+    }
+
+    disk_latency_us = 100;
+    printf("FF_FS_REENTRANT = %d\n", FF_FS_REENTRANT);
+    for (wr = 0; wr < 2; wr++) {
+        for (chunk = 512; chunk <= 4096; chunk *= 8) {
+            for (nt = 1; nt <= 8; nt *= 2) {
+                stop = 0; nwritten = 0;
+                for (i = 0; i < nt; i++) { nreads[i] = 0; pthread_create(&th[i], NULL, reader, (void*)(long)i); }
+                if (wr) pthread_create(&tw, NULL, writer, &nwritten);
+                usleep(500000);
+                stop = 1;
+                total = 0;
+                for (i = 0; i < nt; i++) { pthread_join(th[i], NULL); total += nreads[i]; }
+                if (wr) pthread_join(tw, NULL);
+                printf("%s %4u bytes, %d threads: %6ld reads/s\n", wr ? "+writer" : "       ", chunk, nt, total * 2);
+                if (wr && (f_stat("log", &fno) != FR_OK || fno.fsize != (FSIZE_t)nwritten * 3000)) { puts("log size mismatch"); nerror++; }
+            }
+        }
+    }
+
+#if FF_FS_STCACHE
+    /* Media change while the readers are running */
+    chunk = 4096; stop = 0;
+    for (i = 0; i < 8; i++) pthread_create(&th[i], NULL, reader, (void*)(long)i);
+    usleep(100000);
+    changed = 1;
+    if (f_media_changed(0) != FR_OK) { puts("f_media_changed failed"); nerror++; }
+    for (i = 0; i < 8; i++) pthread_join(th[i], NULL);
+#endif
+    f_mount(NULL, "", 0);
+
+    printf("%s\n", nerror ? "FAILED" : "OK");
+    return nerror ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+/*----------------------------------------------------------------------/
+/ Multi-volume stress of the volume lock at FF_FS_REENTRANT (host)      /
+/-----------------------------------------------------------------------/
+/ 1 to 16 threads do a random mix of open/read, append, readdir and
+/ unlink calls on two volumes for the given number of seconds per row.
+/ The volumes are 32 MiB image files with 50 us access latency. Each row
+/ reports the calls per second, the mean wait per lock request taken by
+/ ff_req_grant() in sync_posix.c, the median and 99th percentile call
+/ latency, and the calls failed with FR_TIMEOUT or with another error.
+/ A small FF_FS_TIMEOUT, e.g. 2, shows the timeouts under contention.
+/
+/ Build on a Linux host from a copy of ../../source in src/ whose ffconf.h
+/ has FF_USE_MKFS 1, FF_VOLUMES 2, FF_FS_REENTRANT 1 (or 2), FF_FS_TIMEOUT
+/ 1000 and FF_SYNC_t pthread_mutex_t*
+/
+/ cc -O2 -D__RC2014 -I. -Isrc -include arch/rc2014/diskio.h reentrant_stress.c
+/    diskio_host.c sync_posix.c src/ff.c src/ffunicode.c -lpthread -o reentrant_stress
+/
+/ ./reentrant_stress [seconds per row]
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ff.h"
+
+#define MAXLAT      200000      /* Call latencies kept per thread */
+#define NSECT       65536       /* Size of each volume */
+
+extern __thread double sync_wait_us;
+extern __thread unsigned long sync_nreq;
+
+typedef struct {
+    long ncall, ntimeout, nerr;
+    unsigned long nreq;
+    double wait;
+    int nlat;
+    double lat[MAXLAT];
+} STAT;
+
+static STAT Stat[16];
+static FATFS FatFs[2];
+static volatile int stop;
+
+
+static
+double now (void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+static
+FRESULT timed (         /* Record a call and pass its result through */
+    STAT* s,
+    FRESULT res,
+    double t0
+)
+{
+    if (s->nlat < MAXLAT) s->lat[s->nlat++] = now() - t0;
+    s->ncall++;
+    if (res == FR_TIMEOUT) {
+        s->ntimeout++;
+    } else if (res != FR_OK && res != FR_NO_FILE && res != FR_EXIST) {
+        s->nerr++;
+    }
+    return res;
+}
+
+#define CALL(x) (t0 = now(), timed(s, (x), t0))
+
+
+static
+void* worker (
+    void* arg
+)
+{
+    static __thread BYTE buff[4096];
+    long id = (long)arg;
+    STAT *s = &Stat[id];
+    unsigned int seed = (unsigned int)id * 7 + 1;
+    double t0;
+    char path[32];
+    FIL fil;
+    DIR dir;
+    FILINFO fno;
+    UINT n;
+    int v, k, op;
+
+
+    sync_wait_us = 0; sync_nreq = 0;
+    while (!stop) {
+        v = rand_r(&seed) & 1; k = rand_r(&seed) % 8; op = rand_r(&seed) % 10;
+        sprintf(path, "%d:/t%ld_%d", v, id, k);
+        if (op < 4) {           /* Read */
+            if (CALL(f_open(&fil, path, FA_READ)) == FR_OK) {
+                CALL(f_read(&fil, buff, sizeof buff, &n));
+                CALL(f_close(&fil));
+            }
+        } else if (op < 7) {    /* Append */
+            if (CALL(f_open(&fil, path, FA_WRITE | FA_OPEN_APPEND)) == FR_OK) {
+                memset(buff, (int)id, sizeof buff);
+                CALL(f_write(&fil, buff, 1024 + rand_r(&seed) % 3072, &n));
+                CALL(f_close(&fil));
+            }
+        } else if (op < 9) {    /* Read directory */
+            sprintf(path, "%d:/", v);
+            if (CALL(f_opendir(&dir, path)) == FR_OK) {
+                while (CALL(f_readdir(&dir, &fno)) == FR_OK && fno.fname[0]) ;
+                CALL(f_closedir(&dir));
+            }
+        } else {                /* Remove */
+            CALL(f_unlink(path));
+        }
+    }
+    s->wait = sync_wait_us; s->nreq = sync_nreq;
+    return 0;
+}
+
+
+static
+int cmp_dbl (const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+
+int main (int argc, char* argv[])
+{
+    static BYTE work[8192];
+    double secs = (argc > 1) ? atof(argv[1]) : 1.0, wait, *all;
+    long calls, nto, nerr;
+    unsigned long nreq;
+    pthread_t th[16];
+    int i, nt, na;
+    char path[32];
+
+
+    for (i = 0; i < 2; i++) {
+        sprintf(path, "reentrant_stress%d.img", i);
+        if (disk_attach((BYTE)i, path, NSECT) != 0) { puts("disk_attach failed"); return 1; }
+        sprintf(path, "%d:", i);
+        if (f_mkfs(path, FM_ANY, 512, work, sizeof work) != FR_OK) { puts("f_mkfs failed"); return 1; }
+        if (f_mount(&FatFs[i], path, 1) != FR_OK) { puts("f_mount failed"); return 1; }
+    }
+    disk_latency_us = 50;
+
+    printf("FF_FS_REENTRANT = %d, FF_FS_TIMEOUT = %d\n", FF_FS_REENTRANT, FF_FS_TIMEOUT);
+    printf("threads   calls/s   wait/lock(us)  p50(us)  p99(us)  timeouts  errors\n");
+    for (nt = 1; nt <= 16; nt *= 2) {
+        stop = 0;
+        memset(Stat, 0, sizeof Stat);
+        for (i = 0; i < nt; i++) pthread_create(&th[i], NULL, worker, (void*)(long)i);
+        usleep((useconds_t)(secs * 1e6));
+        stop = 1;
+        calls = nto = nerr = 0; nreq = 0; wait = 0;
+        for (i = 0; i < nt; i++) {
+            pthread_join(th[i], NULL);
+            calls += Stat[i].ncall; nto += Stat[i].ntimeout; nerr += Stat[i].nerr;
+            nreq += Stat[i].nreq; wait += Stat[i].wait;
+        }
+        all = malloc(sizeof (double) * MAXLAT * nt);
+        if (!all) return 1;
+        for (i = na = 0; i < nt; i++) {
+            memcpy(all + na, Stat[i].lat, Stat[i].nlat * sizeof (double));
+            na += Stat[i].nlat;
+        }
+        qsort(all, na, sizeof (double), cmp_dbl);
+        printf("%7d %9.0f %15.1f %8.1f %8.1f %9ld %7ld\n", nt, calls / secs, nreq ? wait / nreq : 0,
+            all[na / 2] * 1e6, all[na * 99 / 100] * 1e6, nto, nerr);
+        free(all);
+    }
+    return 0;
+}
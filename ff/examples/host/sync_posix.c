@@ -0,0 +1,80 @@
+/*-----------------------------------------------------------------------/
+/  POSIX threads sync functions for the host examples                    /
+/-----------------------------------------------------------------------/
+/  FF_SYNC_t is pthread_mutex_t* and FF_FS_TIMEOUT is in milliseconds.
+/  ff_req_grant() also adds the time it waited for the volume to the
+/  thread-local sync_wait_us and counts the requests in sync_nreq, so
+/  that the examples can report the lock contention. A tick of
+/  ff_wait_tick() is 1 ms.
+*/
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ff.h"
+
+#if FF_FS_REENTRANT
+
+__thread double sync_wait_us;
+__thread unsigned long sync_nreq;
+
+
+int ff_cre_syncobj (    /* 1:Function succeeded, 0:Could not create the sync object */
+    BYTE vol,           /* Corresponding volume (logical drive number) */
+    FF_SYNC_t *sobj     /* Pointer to return the created sync object */
+)
+{
+    (void)vol;
+    *sobj = malloc(sizeof (pthread_mutex_t));
+    if (*sobj && pthread_mutex_init(*sobj, NULL) != 0) { free(*sobj); *sobj = NULL; }
+    return (int)(*sobj != NULL);
+}
+
+
+int ff_del_syncobj (    /* 1:Function succeeded, 0:Could not delete due to an error */
+    FF_SYNC_t sobj      /* Sync object tied to the logical drive to be deleted */
+)
+{
+    pthread_mutex_destroy(sobj);
+    free(sobj);
+    return 1;
+}
+
+
+int ff_req_grant (      /* 1:Got a grant to access the volume, 0:Could not get a grant */
+    FF_SYNC_t sobj      /* Sync object to wait */
+)
+{
+    struct timespec ts, t0, t1;
+    int r;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += FF_FS_TIMEOUT / 1000;
+    ts.tv_nsec += (FF_FS_TIMEOUT % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+    r = (pthread_mutex_timedlock(sobj, &ts) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sync_wait_us += (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) * 1e-3;
+    sync_nreq++;
+    return r;
+}
+
+
+void ff_rel_grant (
+    FF_SYNC_t sobj      /* Sync object to be signaled */
+)
+{
+    pthread_mutex_unlock(sobj);
+}
+
+
+#if FF_FS_REENTRANT == 2
+void ff_wait_tick (void)
+{
+    usleep(1000);
+}
+#endif
+
+#endif
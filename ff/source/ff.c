@@ -114,6 +114,7 @@
 #define MAX_FAT16    0xFFF5            /* Max FAT16 clusters (differs from specs, but correct for real DOS/Windows behavior) */
 #define MAX_FAT32    0x0FFFFFF5        /* Max FAT32 clusters (not specified, practical limit) */
 #define MAX_EXFAT    0x7FFFFFFD        /* Max exFAT clusters (differs from specs, implementation limit) */
+#define RECLAIM_SLICE    128        /* Number of clusters freed by f_sync() in deferred chain removal */
 
 
 /* FatFs refers the FAT structure as simple byte array instead of structure member
@@ -238,7 +239,11 @@
 
 
 /* Post process after fatal error on file operation */
+#if FF_FS_STCACHE
+#define ABORT(fs, res)        { fp->err = (BYTE)(res); (fs)->st_cnt = 0; LEAVE_FF(fs, res); }
+#else
 #define ABORT(fs, res)        { fp->err = (BYTE)(res); LEAVE_FF(fs, res); }
+#endif
 
 
 /* Reentrancy related */
@@ -246,6 +251,9 @@
 #if FF_USE_LFN == 1
 #error Static LFN work area cannot be used at thread-safe configuration
 #endif
+#if FF_FS_REENTRANT == 2 && FF_FS_TINY
+#error FF_FS_REENTRANT == 2 cannot be used at tiny configuration
+#endif
 #define LEAVE_FF(fs, res)    { unlock_fs(fs, res); return res; }
 #else
 #define LEAVE_FF(fs, res)    return res
@@ -273,6 +281,12 @@
 #endif
 
 
+/* Chain removal batch */
+#if FF_CHAIN_RUNS < 1 || FF_CHAIN_RUNS > 64
+#error Wrong FF_CHAIN_RUNS setting
+#endif
+
+
 /* Timestamp */
 #if FF_FS_NORTC == 1
 #if FF_NORTC_YEAR < 1980 || FF_NORTC_YEAR > 2107 || FF_NORTC_MON < 1 || FF_NORTC_MON > 12 || FF_NORTC_MDAY < 1 || FF_NORTC_MDAY > 31
@@ -790,6 +804,27 @@ void unlock_fs (
     }
 }
 
+
+#if FF_FS_REENTRANT == 2
+static
+int lock_idle (        /* 1:Ok, 0:timeout */
+    FATFS* fs        /* Filesystem object */
+)
+{
+    DWORD tmo = FF_FS_TIMEOUT;
+
+
+    if (!lock_fs(fs)) return 0;
+    while (fs->n_xfer != 0) {    /* Wait for the data transfers running without the grant */
+        unlock_fs(fs, FR_OK);
+        if (tmo-- == 0) return 0;    /* Timeout */
+        ff_wait_tick();            /* Block a tick to let the transferring tasks run */
+        if (!lock_fs(fs)) return 0;
+    }
+    return 1;
+}
+#endif
+
 #endif
 
 
@@ -1018,6 +1053,29 @@ DWORD clst2sect (    /* !=0:Sector number, 0:Failed (invalid cluster#) */
 
 
 
+#if !FF_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* Get FAT sector number of a cluster entry                              */
+/*-----------------------------------------------------------------------*/
+
+static
+DWORD clst2fsect (    /* Sector number in the 1st FAT holding the entry */
+    FATFS* fs,        /* Filesystem object */
+    DWORD clst        /* Cluster# to be converted */
+)
+{
+    switch (fs->fs_type) {
+    case FS_FAT12 :
+        return fs->fatbase + (clst + clst / 2) / SS(fs);
+    case FS_FAT16 :
+        return fs->fatbase + clst / (SS(fs) / 2);
+    }
+    return fs->fatbase + clst / (SS(fs) / 4);
+}
+#endif
+
+
+
 
 /*-----------------------------------------------------------------------*/
 /* FAT access - Read value of a FAT entry                                */
@@ -1114,6 +1172,7 @@ FRESULT put_fat (    /* FR_OK(0):succeeded, !=0:error */
 
 
     if (clst >= 2 && clst < fs->n_fatent) {    /* Check if in valid range */
+        fs->fat_chg++;                    /* Invalidate the FAT scans in progress */
         switch (fs->fs_type) {
         case FS_FAT12 :
             bc = (UINT)clst; bc += bc / 2;    /* bc: byte offset of the entry */
@@ -1176,29 +1235,42 @@ DWORD find_bitmap (    /* 0:Not found, 2..:Cluster block found, 0xFFFFFFFF:Disk
 {
     BYTE bm, bv;
     UINT i;
-    DWORD val, scl, ctr;
+    DWORD val, scl, ctr, nbit;
 
 
+    nbit = fs->n_fatent - 2;    /* Number of bits in the bitmap */
     clst -= 2;    /* The first bit in the bitmap corresponds to cluster #2 */
-    if (clst >= fs->n_fatent - 2) clst = 0;
+    if (clst >= nbit) clst = 0;
     scl = val = clst; ctr = 0;
     for (;;) {
         if (move_window(fs, fs->database + val / 8 / SS(fs)) != FR_OK) return 0xFFFFFFFF;    /* (assuming bitmap is located top of the cluster heap) */
-        i = val / 8 % SS(fs); bm = 1 << (val % 8);
+        i = val / 8 % SS(fs);
         do {
-            do {
-                bv = fs->win[i] & bm; bm <<= 1;        /* Get bit value */
-                if (++val >= fs->n_fatent - 2) {    /* Next cluster (with wrap-around) */
-                    val = 0; bm = 0; i = SS(fs);
-                }
-                if (!bv) {    /* Is it a free cluster? */
-                    if (++ctr == ncl) return scl + 2;    /* Check if run length is sufficient for required */
+            bv = fs->win[i];
+            if (val % 8 == 0 && (bv == 0 || bv == 0xFF) && nbit - val >= 8 && (val >= clst || clst - val >= 8)) {    /* Whole byte in-use or free? */
+                val += 8;
+                if (bv) {
+                    scl = val; ctr = 0;        /* 8 clusters in-use, restart to scan */
                 } else {
-                    scl = val; ctr = 0;        /* Encountered a cluster in-use, restart to scan */
+                    ctr += 8;                /* 8 free clusters */
+                    if (ctr >= ncl) return scl + 2;
                 }
-                if (val == clst) return 0;    /* All cluster scanned? */
-            } while (bm);
-            bm = 1;
+            } else {                        /* Mixed byte, or at an end of the scan range */
+                bm = 1 << (val % 8);
+                do {
+                    val++;
+                    if (!(bv & bm)) {    /* Is it a free cluster? */
+                        if (++ctr == ncl) return scl + 2;    /* Check if run length is sufficient for required */
+                    } else {
+                        scl = val; ctr = 0;        /* Encountered a cluster in-use, restart to scan */
+                    }
+                    bm <<= 1;
+                } while (bm && val < nbit && val != clst);
+            }
+            if (val >= nbit) {    /* Next cluster (with wrap-around, a block does not straddle the end) */
+                val = 0; scl = 0; ctr = 0; i = SS(fs);
+            }
+            if (val == clst) return 0;    /* All cluster scanned? */
         } while (++i < SS(fs));
     }
 }
@@ -1216,26 +1288,40 @@ FRESULT change_bitmap (
     int bv        /* bit value to be set (0 or 1) */
 )
 {
-    BYTE bm;
-    UINT i;
+    BYTE bm, bf, bc;
+    UINT i, n, b;
     DWORD sect;
 
 
+    fs->fat_chg++;    /* Invalidate the bitmap scans in progress */
     clst -= 2;    /* The first bit corresponds to cluster #2 */
     sect = fs->database + clst / 8 / SS(fs);    /* Sector address (assuming bitmap is located top of the cluster heap) */
     i = clst / 8 % SS(fs);                        /* Byte offset in the sector */
-    bm = 1 << (clst % 8);                        /* Bit mask in the byte */
+    b = clst % 8;                                /* Bit offset in the byte */
+    bf = bv ? 0xFF : 0;                            /* Byte value of a whole byte changed */
+    bc = (BYTE)~bf;                                /* Byte value of a whole byte to be changed */
     for (;;) {
         if (move_window(fs, sect++) != FR_OK) return FR_DISK_ERR;
         do {
-            do {
-                if (bv == (int)((fs->win[i] & bm) != 0)) return FR_INT_ERR;    /* Is the bit expected value? */
-                fs->win[i] ^= bm;    /* Flip the bit */
-                fs->wflag = 1;
-                if (--ncl == 0) return FR_OK;    /* All bits processed? */
-            } while (bm <<= 1);        /* Next bit */
-            bm = 1;
-        } while (++i < SS(fs));        /* Next byte */
+            if (b == 0 && ncl >= 8) {    /* Whole bytes */
+                n = SS(fs) - i;
+                if (n > ncl / 8) n = (UINT)(ncl / 8);
+                for (b = 0; b < n; b++) {
+                    if (fs->win[i + b] != bc) return FR_INT_ERR;    /* Are all bits the expected value? */
+                }
+                MEMSET(fs->win + i, bf, n);    /* Set the bytes */
+                i += n; ncl -= (DWORD)n * 8; b = 0;
+            } else {                    /* Partial byte at head or tail of the block */
+                n = 8 - b;
+                if (n > ncl) n = (UINT)ncl;
+                bm = (BYTE)(((1 << n) - 1) << b);        /* Bit mask in the byte */
+                if ((fs->win[i] & bm) != (bv ? 0 : bm)) return FR_INT_ERR;    /* Are the bits the expected value? */
+                fs->win[i] ^= bm;    /* Flip the bits */
+                i++; ncl -= n; b = 0;
+            }
+            fs->wflag = 1;
+            if (ncl == 0) return FR_OK;    /* All bits processed? */
+        } while (i < SS(fs));        /* Next byte */
         i = 0;
     }
 }
@@ -1291,6 +1377,67 @@ FRESULT fill_last_frag (
 
 
 
+#if !FF_FS_READONLY && FF_APPEND_CACHE
+/*-----------------------------------------------------------------------*/
+/* Append cache - Register/Find the end of a cluster chain               */
+/*-----------------------------------------------------------------------*/
+
+static
+void put_acache (
+    FIL* fp        /* File object (registered if the file pointer is in the last cluster) */
+)
+{
+    FATFS *fs = fp->obj.fs;
+    DWORD scl = fp->obj.sclust, ncl;
+    UINT i;
+
+
+    if (fp->fptr == 0) return;
+    ncl = (DWORD)((fp->obj.objsize - 1) / SS(fs) / fs->csize);    /* Number of links to the last cluster */
+    if ((DWORD)((fp->fptr - 1) / SS(fs) / fs->csize) != ncl) return;
+    for (i = 0; i < FF_APPEND_CACHE - 1 && fs->ac_ent[i][0] != scl; i++) ;    /* Find the item or the oldest one */
+    for ( ; i > 0; i--) {    /* Move the items below */
+        fs->ac_ent[i][0] = fs->ac_ent[i - 1][0];
+        fs->ac_ent[i][1] = fs->ac_ent[i - 1][1];
+        fs->ac_ent[i][2] = fs->ac_ent[i - 1][2];
+    }
+    fs->ac_ent[0][0] = scl;    /* Put the chain on the top */
+    fs->ac_ent[0][1] = fp->clust;
+    fs->ac_ent[0][2] = ncl + 1;
+}
+
+
+static
+DWORD get_acache (    /* 0:Not found, >=2:Last cluster of the chain */
+    FATFS* fs,        /* Filesystem object */
+    DWORD scl,        /* Top cluster of the chain */
+    DWORD ncl        /* Number of clusters in the chain */
+)
+{
+    UINT i;
+
+
+    for (i = 0; i < FF_APPEND_CACHE; i++) {
+        if (fs->ac_ent[i][0] == scl && fs->ac_ent[i][2] == ncl) {
+            fs->ac_hit++;
+            return fs->ac_ent[i][1];
+        }
+    }
+    fs->ac_miss++;
+    return 0;
+}
+
+#define CLEAR_ACACHE(fs) MEMSET((fs)->ac_ent, 0, sizeof (fs)->ac_ent)
+#else
+#define CLEAR_ACACHE(fs)
+#endif
+
+/* Number of clusters occupied by sz bytes (0xFFFFFFFF:not known for a zero size) */
+#define SIZE_CLST(fs, sz) ((sz) ? (DWORD)(((FSIZE_t)(sz) - 1) / SS(fs) / (fs)->csize + 1) : 0xFFFFFFFF)
+
+
+
+
 #if !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Remove a cluster chain                                 */
@@ -1303,16 +1450,16 @@ FRESULT remove_chain (    /* FR_OK(0):succeeded, !=0:error */
 )
 {
     FRESULT res = FR_OK;
-    DWORD nxt;
+    DWORD nxt, scl, ecl, sect, bsect = 0;
+    DWORD rl[FF_CHAIN_RUNS][2];    /* Cluster runs {first, last} collected from the chain */
+    UINT n, i, j;
     FATFS *fs = obj->fs;
-#if FF_FS_EXFAT || FF_USE_TRIM
-    DWORD scl = clst, ecl = clst;
-#endif
 #if FF_USE_TRIM
     DWORD rt[2];
 #endif
 
     if (clst < 2 || clst >= fs->n_fatent) return FR_INT_ERR;    /* Check if in valid range */
+    CLEAR_ACACHE(fs);    /* Any chain end in the append cache can be changed */
 
     /* Mark the previous cluster 'EOC' on the FAT if it exists */
     if (pclst != 0 && (!FF_FS_EXFAT || fs->fs_type != FS_EXFAT || obj->stat != 2)) {
@@ -1320,40 +1467,83 @@ FRESULT remove_chain (    /* FR_OK(0):succeeded, !=0:error */
         if (res != FR_OK) return res;
     }
 
-    /* Remove the chain */
+    /* Remove the chain in batches. The chain is read into runs of contiguous clusters first,
+       then the runs are freed grouped by the FAT sector so that a fragmented chain does not
+       move the window back and forth between the FAT sectors. */
+#if FF_USE_TRIM
+    rt[0] = rt[1] = 0;    /* Cluster block pending to be trimmed */
+#endif
     do {
-        nxt = get_fat(obj, clst);            /* Get cluster status */
-        if (nxt == 0) break;                /* Empty cluster? */
-        if (nxt == 1) return FR_INT_ERR;    /* Internal error? */
-        if (nxt == 0xFFFFFFFF) return FR_DISK_ERR;    /* Disk error? */
-        if (!FF_FS_EXFAT || fs->fs_type != FS_EXFAT) {
-            res = put_fat(fs, clst, 0);        /* Mark the cluster 'free' on the FAT */
-            if (res != FR_OK) return res;
-        }
-        if (fs->free_clst < fs->n_fatent - 2) {    /* Update FSINFO */
-            fs->free_clst++;
-            fs->fsi_flag |= 1;
+        n = 0;
+        for (;;) {    /* Collect the runs */
+            if (fs->fs_type != FS_EXFAT) {
+                sect = clst2fsect(fs, clst);
+                if (n == 0) {
+                    bsect = sect;        /* FAT sector where this batch started */
+                } else if (sect != fs->winsect && (fs->wflag || (fs->winsect == bsect && sect > bsect))) {
+                    break;    /* Leaving a dirty window or going on to the next FAT sector? (free the collected runs first) */
+                }
+            }
+            nxt = get_fat(obj, clst);            /* Get cluster status */
+            if (nxt == 0) {                    /* Empty cluster? */
+                clst = fs->n_fatent; break;
+            }
+            if (nxt == 1) return FR_INT_ERR;    /* Internal error? */
+            if (nxt == 0xFFFFFFFF) return FR_DISK_ERR;    /* Disk error? */
+            if (n > 0 && rl[n - 1][1] + 1 == clst) {    /* Is it contiguous to the current run? */
+                rl[n - 1][1] = clst;
+            } else {
+                if (n == FF_CHAIN_RUNS) break;        /* Buffer full? (continue from this cluster in next batch) */
+                rl[n][0] = rl[n][1] = clst; n++;
+            }
+            clst = nxt;                    /* Next cluster */
+            if (clst >= fs->n_fatent) break;    /* Last link? */
         }
-#if FF_FS_EXFAT || FF_USE_TRIM
-        if (ecl + 1 == nxt) {    /* Is next cluster contiguous? */
-            ecl = nxt;
-        } else {                /* End of contiguous cluster block */
+
+        while (n > 0) {    /* Free the runs, lowest cluster number first */
+            for (i = 0, j = 1; j < n; j++) {
+                if (rl[j][0] < rl[i][0]) i = j;
+            }
+            scl = rl[i][0]; ecl = rl[i][1];
+            rl[i][0] = rl[n - 1][0]; rl[i][1] = rl[n - 1][1]; n--;
 #if FF_FS_EXFAT
             if (fs->fs_type == FS_EXFAT) {
                 res = change_bitmap(fs, scl, ecl - scl + 1, 0);    /* Mark the cluster block 'free' on the bitmap */
                 if (res != FR_OK) return res;
-            }
+            } else
 #endif
+            {
+                for (nxt = scl; nxt <= ecl; nxt++) {
+                    res = put_fat(fs, nxt, 0);        /* Mark the cluster 'free' on the FAT */
+                    if (res != FR_OK) return res;
+                }
+            }
+            if (fs->free_clst < fs->n_fatent - 2) {    /* Update FSINFO */
+                fs->free_clst += ecl - scl + 1;
+                if (fs->free_clst > fs->n_fatent - 2) fs->free_clst = fs->n_fatent - 2;
+                fs->fsi_flag |= 1;
+            }
 #if FF_USE_TRIM
-            rt[0] = clst2sect(fs, scl);                    /* Start of data area freed */
-            rt[1] = clst2sect(fs, ecl) + fs->csize - 1;    /* End of data area freed */
-            disk_ioctl(fs->pdrv, CTRL_TRIM, rt);        /* Inform device the data in the block is no longer needed */
+            if (rt[1] != 0 && rt[1] + 1 == scl) {    /* Is the run contiguous to the pending block? */
+                rt[1] = ecl;
+            } else {
+                if (rt[1] != 0) {
+                    rt[0] = clst2sect(fs, rt[0]);                    /* Start of data area freed */
+                    rt[1] = clst2sect(fs, rt[1]) + fs->csize - 1;    /* End of data area freed */
+                    disk_ioctl(fs->pdrv, CTRL_TRIM, rt);        /* Inform device the data in the block is no longer needed */
+                }
+                rt[0] = scl; rt[1] = ecl;
+            }
 #endif
-            scl = ecl = nxt;
         }
-#endif
-        clst = nxt;                    /* Next cluster */
     } while (clst < fs->n_fatent);    /* Repeat while not the last link */
+#if FF_USE_TRIM
+    if (rt[1] != 0) {    /* Trim the last block */
+        rt[0] = clst2sect(fs, rt[0]);
+        rt[1] = clst2sect(fs, rt[1]) + fs->csize - 1;
+        disk_ioctl(fs->pdrv, CTRL_TRIM, rt);
+    }
+#endif
 
 #if FF_FS_EXFAT
     /* Some post processes for chain status */
@@ -1387,6 +1577,106 @@ FRESULT remove_chain (    /* FR_OK(0):succeeded, !=0:error */
 
 
 
+#if FF_FS_RECLAIM
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Free a slice of the chains pending to be removed       */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT reclaim_chain (    /* FR_OK(0):succeeded, !=0:error */
+    FATFS* fs,            /* Filesystem object */
+    DWORD budget        /* Maximum number of clusters to be freed */
+)
+{
+    FRESULT res;
+    DWORD clst, nxt, scl, ecl;
+    UINT i;
+    FFOBJID obj;
+#if FF_USE_TRIM
+    DWORD rt[2];
+#endif
+
+
+    obj.fs = fs;
+    while (budget > 0 && (clst = fs->rcl_clst[0]) != 0) {
+        scl = clst; ecl = 0;
+        do {    /* Free a contiguous block from top of the chain (the rest of chain is left as a lost chain) */
+            nxt = get_fat(&obj, clst);            /* Get cluster status */
+            if (nxt == 1) return FR_INT_ERR;    /* Internal error? */
+            if (nxt == 0xFFFFFFFF) return FR_DISK_ERR;    /* Disk error? */
+            if (nxt == 0) break;                /* Empty cluster? */
+            res = put_fat(fs, clst, 0);            /* Mark the cluster 'free' on the FAT */
+            if (res != FR_OK) return res;
+            if (fs->free_clst < fs->n_fatent - 2) {    /* Update FSINFO */
+                fs->free_clst++;
+                fs->fsi_flag |= 1;
+            }
+            if (fs->rcl_ncl[0] != 0xFFFFFFFF && fs->rcl_ncl[0] > 0) fs->rcl_ncl[0]--;    /* Update number of pending clusters */
+            ecl = clst; clst = nxt;
+        } while (--budget > 0 && clst == ecl + 1);
+#if FF_USE_TRIM
+        if (ecl != 0) {
+            rt[0] = clst2sect(fs, scl);                    /* Start of data area freed */
+            rt[1] = clst2sect(fs, ecl) + fs->csize - 1;    /* End of data area freed */
+            disk_ioctl(fs->pdrv, CTRL_TRIM, rt);        /* Inform device the data in the block is no longer needed */
+        }
+#endif
+        if (nxt >= 2 && nxt < fs->n_fatent) {    /* Does the chain continue? */
+            fs->rcl_clst[0] = nxt;
+        } else {                                /* Remove the chain from the list */
+            for (i = 1; i < FF_FS_RECLAIM; i++) {
+                fs->rcl_clst[i - 1] = fs->rcl_clst[i];
+                fs->rcl_ncl[i - 1] = fs->rcl_ncl[i];
+            }
+            fs->rcl_clst[FF_FS_RECLAIM - 1] = 0;
+        }
+    }
+    return FR_OK;
+}
+#endif
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Remove a cluster chain, deferred if possible           */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT release_chain (    /* FR_OK(0):succeeded, !=0:error */
+    FFOBJID* obj,        /* Corresponding object */
+    DWORD clst,            /* Cluster to remove a chain from */
+    DWORD pclst,        /* Previous cluster of clst (0:entire chain) */
+    DWORD ncl            /* Number of clusters in the chain (0xFFFFFFFF:not known) */
+)
+{
+#if FF_FS_RECLAIM
+    FRESULT res;
+    UINT i;
+    FATFS *fs = obj->fs;
+
+
+    if (fs->fs_type != FS_EXFAT && clst >= 2 && clst < fs->n_fatent) {    /* exFAT volume is always processed in synchronous */
+        for (i = 0; i < FF_FS_RECLAIM && fs->rcl_clst[i] != 0; i++) ;
+        if (i < FF_FS_RECLAIM) {    /* Is there a room in the list? */
+            if (pclst != 0) {        /* Mark the previous cluster 'EOC' on the FAT if it exists */
+                res = put_fat(fs, pclst, 0xFFFFFFFF);
+                if (res != FR_OK) return res;
+            }
+            fs->rcl_clst[i] = clst;    /* Put the chain on the list */
+            fs->rcl_ncl[i] = ncl;    /* Number of clusters in it, counted at f_getfree() if not known */
+            CLEAR_ACACHE(fs);
+            return FR_OK;
+        }
+    }
+#endif
+    (void)ncl;
+    return remove_chain(obj, clst, pclst);
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Stretch a chain or Create a new chain                  */
 /*-----------------------------------------------------------------------*/
@@ -1412,7 +1702,14 @@ DWORD create_chain (    /* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk
         if (cs < fs->n_fatent) return cs;    /* It is already followed by next cluster */
         scl = clst;                            /* Cluster to start to find */
     }
-    if (fs->free_clst == 0) return 0;        /* No free cluster */
+    if (fs->free_clst == 0) {        /* No free cluster */
+#if FF_FS_RECLAIM
+        if (fs->rcl_clst[0] == 0) return 0;
+        if (reclaim_chain(fs, 0xFFFFFFFF) != FR_OK) return 0xFFFFFFFF;    /* Free the pending chains */
+#else
+        return 0;
+#endif
+    }
 
 #if FF_FS_EXFAT
     if (fs->fs_type == FS_EXFAT) {    /* On the exFAT volume */
@@ -1459,12 +1756,25 @@ DWORD create_chain (    /* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk
                 ncl++;                            /* Next cluster */
                 if (ncl >= fs->n_fatent) {        /* Check wrap-around */
                     ncl = 2;
-                    if (ncl > scl) return 0;    /* No free cluster found? */
+                    if (ncl > scl) {            /* No free cluster found? */
+                        ncl = 0; break;
+                    }
                 }
                 cs = get_fat(obj, ncl);            /* Get the cluster status */
                 if (cs == 0) break;                /* Found a free cluster? */
                 if (cs == 1 || cs == 0xFFFFFFFF) return cs;    /* Test for error */
-                if (ncl == scl) return 0;        /* No free cluster found? */
+                if (ncl == scl) {                /* No free cluster found? */
+                    ncl = 0; break;
+                }
+            }
+            if (ncl == 0) {
+#if FF_FS_RECLAIM
+                if (fs->rcl_clst[0] != 0) {        /* Free the pending chains and retry */
+                    if (reclaim_chain(fs, 0xFFFFFFFF) != FR_OK) return 0xFFFFFFFF;
+                    return create_chain(obj, clst);
+                }
+#endif
+                return 0;
             }
         }
         res = put_fat(fs, ncl, 0xFFFFFFFF);        /* Mark the new cluster 'EOC' */
@@ -1489,6 +1799,85 @@ DWORD create_chain (    /* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk
 
 
 
+/*-----------------------------------------------------------------------*/
+/* File access - Get next cluster of the file                            */
+/*-----------------------------------------------------------------------*/
+/* The clusters known to be contiguous from top of the file are followed */
+/* without any FAT access, and the contiguous part is learned as the     */
+/* chain is followed.                                                    */
+
+static
+DWORD next_clust (    /* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk error, >=2:Next cluster# */
+    FFOBJID* obj,    /* Corresponding file object */
+    DWORD clst,        /* Current cluster# */
+    int stretch        /* 0:Follow the chain, 1:Follow or stretch the chain */
+)
+{
+    DWORD nxt;
+
+
+#if FF_FS_CONTIG
+    if (obj->n_lead > 1 && clst - obj->sclust < obj->n_lead - 1) {    /* In the contiguous part? */
+        return clst + 1;
+    }
+#endif
+#if !FF_FS_READONLY
+    if (stretch) {
+        nxt = create_chain(obj, clst);
+    } else
+#else
+    (void)stretch;
+#endif
+    {
+        nxt = get_fat(obj, clst);
+    }
+#if FF_FS_CONTIG
+    if (obj->n_lead > 0 && nxt == clst + 1 && clst - obj->sclust == obj->n_lead - 1) {
+        obj->n_lead++;    /* Contiguous part has been extended */
+    }
+#endif
+    return nxt;
+}
+
+
+
+
+#if FF_SEEK_INDEX
+/*-----------------------------------------------------------------------*/
+/* File access - Record a seek checkpoint                                */
+/*-----------------------------------------------------------------------*/
+/* Cluster# of the cluster at fptr is recorded at every 2^ck_shift       */
+/* clusters. When the table is full, the interval is doubled and every   */
+/* second checkpoint is discarded.                                       */
+
+static
+void put_ckpt (
+    FIL* fp,        /* Pointer to the file object (fptr is on the top of the cluster) */
+    DWORD clst        /* Cluster# at fptr */
+)
+{
+    FATFS *fs = fp->obj.fs;
+    DWORD ci;
+    UINT i;
+
+
+    ci = (DWORD)(fp->fptr / SS(fs) / fs->csize);    /* Cluster order from top of the file */
+    if (ci == 0 || (ci & ((1UL << fp->ck_shift) - 1))) return;    /* Not on the checkpoint? */
+    if ((ci >> fp->ck_shift) - 1 != fp->ck_n) return;    /* Not the next checkpoint to be recorded? */
+    if (fp->ck_n == FF_SEEK_INDEX) {    /* Is the table full? */
+        for (i = 0; i < FF_SEEK_INDEX / 2; i++) fp->ck_clst[i] = fp->ck_clst[i * 2 + 1];
+        fp->ck_n = FF_SEEK_INDEX / 2;
+        fp->ck_shift++;        /* Double the interval */
+        if (ci & ((1UL << fp->ck_shift) - 1) || (ci >> fp->ck_shift) - 1 != fp->ck_n) return;
+    }
+    fp->ck_clst[fp->ck_n++] = clst;
+}
+
+#endif    /* FF_SEEK_INDEX */
+
+
+
+
 #if FF_USE_FASTSEEK
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Convert offset into cluster with link map table        */
@@ -3078,6 +3467,48 @@ BYTE check_fs (    /* 0:FAT, 1:exFAT, 2:Valid BS but not FAT, 3:Not a BS, 4:Disk
 
 
 
+#if FF_USE_ASYNC
+/*-----------------------------------------------------------------------*/
+/* Wait for the Asynchronous Transfer in Flight on the Drive             */
+/*-----------------------------------------------------------------------*/
+/* Only one transfer can be in flight on a drive. The object starting it */
+/* is recorded in as_obj of its volume until the transfer is completed.  */
+/* Any other access to the drive waits for the transfer to end on the    */
+/* disk first, the owner of the transfer completes it later.             */
+
+static
+void* async_owner (    /* Object whose transfer is in flight on the drive (0:none) */
+    FATFS* fs        /* Filesystem object */
+)
+{
+    UINT i;
+
+
+    for (i = 0; i < FF_VOLUMES; i++) {    /* Check the volumes on the same drive */
+        if (FatFs[i] && FatFs[i]->pdrv == fs->pdrv && FatFs[i]->as_obj) return FatFs[i]->as_obj;
+    }
+    return 0;
+}
+
+
+static
+void wait_async (
+    FATFS* fs,            /* Filesystem object */
+    const void* obj        /* Object accessing the drive (its own transfer is not waited) */
+)
+{
+    void *owner = async_owner(fs);
+
+
+    if (owner && owner != obj) {
+        while (disk_poll(fs->pdrv) > 0) ;    /* Wait for end of the transfer */
+    }
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Find logical drive and check if the volume is mounted                 */
 /*-----------------------------------------------------------------------*/
@@ -3110,6 +3541,9 @@ FRESULT find_volume (    /* FR_OK(0): successful, !=0: any error occurred */
     if (!lock_fs(fs)) return FR_TIMEOUT;    /* Lock the volume */
 #endif
     *rfs = fs;                            /* Return pointer to the filesystem object */
+#if FF_USE_ASYNC
+    wait_async(fs, 0);                    /* Wait for the transfer in flight on the drive */
+#endif
 
     mode &= (BYTE)~FA_READ;                /* Desired access mode, write access or not */
     if (fs->fs_type != 0) {                /* If the volume has been mounted */
@@ -3126,6 +3560,12 @@ FRESULT find_volume (    /* FR_OK(0): successful, !=0: any error occurred */
     /* Following code attempts to mount the volume. (analyze BPB and initialize the filesystem object) */
 
     fs->fs_type = 0;                    /* Clear the filesystem object */
+#if FF_USE_ASYNC
+    fs->as_obj = 0;                        /* No transfer in flight (the transfer on the old medium has ended) */
+#endif
+#if FF_FS_STCACHE
+    fs->st_cnt = 0;                        /* Invalidate the cached drive status */
+#endif
     fs->pdrv = LD2PD(vol);                /* Bind the logical drive and a physical drive */
     stat = disk_initialize(fs->pdrv);    /* Initialize the physical drive */
     if (stat & STA_NOINIT) {             /* Check if the initialization succeeded */
@@ -3286,6 +3726,14 @@ FRESULT find_volume (    /* FR_OK(0): successful, !=0: any error occurred */
 
     fs->fs_type = fmt;        /* FAT sub-type */
     fs->id = ++Fsid;        /* Volume mount ID */
+#if !FF_FS_READONLY && FF_FS_RECLAIM
+    MEMSET(fs->rcl_clst, 0, sizeof fs->rcl_clst);    /* Clear the list of chains pending to be removed */
+    MEMSET(fs->rcl_ncl, 0, sizeof fs->rcl_ncl);
+#endif
+#if !FF_FS_READONLY && FF_APPEND_CACHE
+    CLEAR_ACACHE(fs);        /* Clear the append cache */
+    fs->ac_hit = fs->ac_miss = 0;
+#endif
 #if FF_USE_LFN == 1
     fs->lfnbuf = LfnBuf;    /* Static LFN working buffer */
 #if FF_FS_EXFAT
@@ -3305,22 +3753,53 @@ FRESULT find_volume (    /* FR_OK(0): successful, !=0: any error occurred */
 
 
 /*-----------------------------------------------------------------------*/
-/* Check if the file/directory object is valid or not                    */
+/* Check if the physical drive is kept initialized                       */
 /*-----------------------------------------------------------------------*/
 
+#if FF_FS_STCACHE
 static
-FRESULT validate (    /* Returns FR_OK or FR_INVALID_OBJECT */
-    FFOBJID* obj,    /* Pointer to the FFOBJID, the 1st member in the FIL/DIR object, to check validity */
-    FATFS** rfs        /* Pointer to pointer to the owner filesystem object to return */
+int drive_ready (    /* 0:Not initialized, 1:Initialized */
+    FATFS* fs        /* Filesystem object */
 )
 {
-    FRESULT res = FR_INVALID_OBJECT;
-
-
+    if (fs->st_cnt) {    /* Is the cached status still valid? */
+        fs->st_cnt--;
+        return 1;
+    }
+    if (disk_status(fs->pdrv) & STA_NOINIT) return 0;
+    fs->st_cnt = FF_FS_STCACHE - 1;    /* Trust the status for the following validations */
+    return 1;
+}
+#else
+#define drive_ready(fs) (!(disk_status((fs)->pdrv) & STA_NOINIT))
+#endif
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Check if the file/directory object is valid or not                    */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT validate (    /* Returns FR_OK or FR_INVALID_OBJECT */
+    FFOBJID* obj,    /* Pointer to the FFOBJID, the 1st member in the FIL/DIR object, to check validity */
+    FATFS** rfs        /* Pointer to pointer to the owner filesystem object to return */
+)
+{
+    FRESULT res = FR_INVALID_OBJECT;
+
+
     if (obj && obj->fs && obj->fs->fs_type && obj->id == obj->fs->id) {    /* Test if the object is valid */
 #if FF_FS_REENTRANT
         if (lock_fs(obj->fs)) {    /* Obtain the filesystem object */
-            if (!(disk_status(obj->fs->pdrv) & STA_NOINIT)) { /* Test if the phsical drive is kept initialized */
+#if FF_FS_REENTRANT == 2
+            if (obj->xfer) {    /* Settle the transfer count left by a grant timeout */
+                obj->fs->n_xfer--;
+                obj->xfer = 0;
+            }
+#endif
+            if (drive_ready(obj->fs)) {    /* Test if the phsical drive is kept initialized */
                 res = FR_OK;
             } else {
                 unlock_fs(obj->fs, FR_OK);
@@ -3329,11 +3808,14 @@ FRESULT validate (    /* Returns FR_OK or FR_INVALID_OBJECT */
             res = FR_TIMEOUT;
         }
 #else
-        if (!(disk_status(obj->fs->pdrv) & STA_NOINIT)) { /* Test if the phsical drive is kept initialized */
+        if (drive_ready(obj->fs)) {    /* Test if the phsical drive is kept initialized */
             res = FR_OK;
         }
 #endif
     }
+#if FF_USE_ASYNC
+    if (res == FR_OK) wait_async(obj->fs, obj);    /* Wait for the transfer of other object on the drive */
+#endif
     *rfs = (res == FR_OK) ? obj->fs : 0;    /* Corresponding filesystem object */
     return res;
 }
@@ -3341,6 +3823,56 @@ FRESULT validate (    /* Returns FR_OK or FR_INVALID_OBJECT */
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Transfer file data between the disk and a data buffer                 */
+/*-----------------------------------------------------------------------*/
+/* At FF_FS_REENTRANT == 2, the volume grant is released during the      */
+/* transfer so that other tasks can access the volume meanwhile. The     */
+/* transfer is counted in n_xfer and f_mount() waits for it to finish    */
+/* before the sync object is deleted. When the grant cannot be got back, */
+/* the count is left to the next validation of the object.               */
+
+static
+FRESULT xfer_data (    /* FR_OK(0):succeeded, !=0:error */
+    FFOBJID* obj,    /* Pointer to the object being transferred */
+    BYTE* buff,        /* Data buffer (not modified at write) */
+    DWORD sect,        /* Start sector */
+    UINT cnt,        /* Number of sectors */
+    int wr            /* 0:Read, 1:Write */
+)
+{
+    FATFS *fs = obj->fs;
+    DRESULT dr;
+
+
+#if FF_FS_REENTRANT == 2
+    fs->n_xfer++;                        /* Keep the volume from being unmounted during the transfer */
+    ff_rel_grant(fs->sobj);                /* Release the volume during the transfer */
+#endif
+#if !FF_FS_READONLY
+    if (wr) {
+        dr = disk_write(fs->pdrv, buff, sect, cnt);
+    } else
+#else
+    (void)wr;
+#endif
+    {
+        dr = disk_read(fs->pdrv, buff, sect, cnt);
+    }
+#if FF_FS_REENTRANT == 2
+    if (!ff_req_grant(fs->sobj)) {        /* Get the grant back (the sync object is kept by n_xfer) */
+        obj->xfer = 1;                    /* n_xfer is decremented at next validation of the object */
+        return FR_TIMEOUT;
+    }
+    fs->n_xfer--;
+    if (!fs->fs_type || obj->id != fs->id) return FR_INVALID_OBJECT;    /* Has the volume been dismounted meanwhile? */
+#endif
+    return (dr == RES_OK) ? FR_OK : FR_DISK_ERR;
+}
+
+
+
+
 /*---------------------------------------------------------------------------
 
    Public Functions (FatFs API)
@@ -3371,6 +3903,11 @@ FRESULT f_mount (
     cfs = FatFs[vol];                    /* Pointer to fs object */
 
     if (cfs) {
+#if FF_FS_REENTRANT == 2
+        if (!lock_idle(cfs)) return FR_TIMEOUT;    /* Wait for the data transfers in progress */
+        cfs->fs_type = 0;                /* The transfers returning later fail on it */
+        unlock_fs(cfs, FR_OK);
+#endif
 #if FF_FS_LOCK != 0
         clear_lock(cfs);
 #endif
@@ -3382,6 +3919,12 @@ FRESULT f_mount (
 
     if (fs) {
         fs->fs_type = 0;                /* Clear new fs object */
+#if FF_FS_REENTRANT == 2
+        fs->n_xfer = 0;
+#endif
+#if FF_USE_ASYNC
+        fs->as_obj = 0;
+#endif
 #if FF_FS_REENTRANT                        /* Create sync object for the new volume */
         if (!ff_cre_syncobj((BYTE)vol, &fs->sobj)) return FR_INT_ERR;
 #endif
@@ -3397,6 +3940,53 @@ FRESULT f_mount (
 
 
 
+#if FF_FS_STCACHE
+/*-----------------------------------------------------------------------*/
+/* Notify Media Change on a Physical Drive                               */
+/*-----------------------------------------------------------------------*/
+/* Called by the disk driver when the medium has been changed or removed. */
+/* The volumes on the drive are dismounted and mounted again on the next  */
+/* access. The objects opened on them get invalid. Each volume is locked  */
+/* while it is dismounted, so that this function must be called from a    */
+/* task, not from an interrupt, at FF_FS_REENTRANT.                       */
+
+FRESULT f_media_changed (
+    BYTE pdrv            /* Physical drive number */
+)
+{
+    FRESULT res = FR_OK;
+    FATFS *fs;
+    UINT i;
+
+
+    for (i = 0; i < FF_VOLUMES; i++) {
+        fs = FatFs[i];
+        if (fs && fs->fs_type && fs->pdrv == pdrv) {    /* Mounted volume on the drive? */
+#if FF_FS_REENTRANT
+            if (!lock_fs(fs)) {        /* Lock the volume */
+                res = FR_TIMEOUT;    /* The volume is left mounted */
+                continue;
+            }
+#endif
+            if (fs->fs_type && fs->pdrv == pdrv) {    /* Still mounted on the drive? */
+#if FF_FS_LOCK != 0
+                clear_lock(fs);
+#endif
+                fs->st_cnt = 0;            /* Invalidate the cached drive status */
+                fs->fs_type = 0;        /* Dismount the volume */
+            }
+#if FF_FS_REENTRANT
+            unlock_fs(fs, FR_OK);
+#endif
+        }
+    }
+    return res;
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Open or Create a File                                                 */
 /*-----------------------------------------------------------------------*/
@@ -3481,6 +4071,7 @@ FRESULT f_open (
                 {
                     /* Set directory entry initial state */
                     cl = ld_clust(fs, dj.dir);            /* Get current cluster chain */
+                    sc = SIZE_CLST(fs, LDDWORD(dj.dir + DIR_FileSize));    /* Number of clusters in it */
                     STDWORD(dj.dir + DIR_CrtTime, GET_FATTIME());    /* Set created time */
                     dj.dir[DIR_Attr] = AM_ARC;            /* Reset attribute */
                     st_clust(fs, dj.dir, 0);            /* Reset file allocation info */
@@ -3488,7 +4079,7 @@ FRESULT f_open (
                     fs->wflag = 1;
                     if (cl != 0) {                        /* Remove the cluster chain if exist */
                         dw = fs->winsect;
-                        res = remove_chain(&dj.obj, cl, 0);
+                        res = release_chain(&dj.obj, cl, 0, sc);
                         if (res == FR_OK) {
                             res = move_window(fs, dw);
                             fs->last_clst = cl - 1;        /* Reuse the cluster hole */
@@ -3545,14 +4136,34 @@ FRESULT f_open (
                 fp->obj.sclust = ld_clust(fs, dj.dir);                    /* Get object allocation info */
                 fp->obj.objsize = LDDWORD(dj.dir + DIR_FileSize);
             }
+#if FF_FS_CONTIG
+            fp->obj.n_lead = fp->obj.sclust ? 1 : 0;    /* Contiguous part is not known yet */
+#endif
+#if !FF_FS_READONLY
+#if FF_USE_DATASYNC
+            fp->dir_sclust = fp->obj.sclust;    /* Allocation info recorded in the directory entry */
+            fp->dir_size = fp->obj.objsize;
+#endif
+#endif
+#if FF_SEEK_INDEX
+            fp->ck_n = 0;            /* Clear the seek checkpoints and set interval for the file size */
+            for (fp->ck_shift = 0; (DWORD)(fp->obj.objsize / SS(fs) / fs->csize) >> fp->ck_shift > FF_SEEK_INDEX; fp->ck_shift++) ;
+#endif
 #if FF_USE_FASTSEEK
             fp->cltbl = 0;            /* Disable fast seek mode */
 #endif
             fp->obj.fs = fs;         /* Validate the file object */
             fp->obj.id = fs->id;
+#if FF_FS_REENTRANT == 2
+            fp->obj.xfer = 0;
+#endif
             fp->flag = mode;        /* Set file access mode */
             fp->err = 0;            /* Clear error flag */
             fp->sect = 0;            /* Invalidate current data sector */
+#if FF_USE_ASYNC
+            fp->as_op = 0;            /* No asynchronous transfer */
+            fp->as_cnt = 0;
+#endif
             fp->fptr = 0;            /* Set file pointer top of the file */
 #if !FF_FS_READONLY
 #if !FF_FS_TINY
@@ -3562,10 +4173,20 @@ FRESULT f_open (
                 fp->fptr = fp->obj.objsize;            /* Offset to seek */
                 bcs = (DWORD)fs->csize * SS(fs);    /* Cluster size in byte */
                 clst = fp->obj.sclust;                /* Follow the cluster chain */
-                for (ofs = fp->obj.objsize; res == FR_OK && ofs > bcs; ofs -= bcs) {
-                    clst = get_fat(&fp->obj, clst);
-                    if (clst <= 1) res = FR_INT_ERR;
-                    if (clst == 0xFFFFFFFF) res = FR_DISK_ERR;
+#if FF_APPEND_CACHE
+                dw = (DWORD)((fp->obj.objsize - 1) / bcs);    /* Number of links to the last cluster */
+                cl = get_acache(fs, clst, dw + 1);
+                if (cl != 0) {                        /* Is the chain end in the append cache? */
+                    clst = cl;
+                    ofs = fp->obj.objsize - (FSIZE_t)dw * bcs;
+                } else
+#endif
+                {
+                    for (ofs = fp->obj.objsize; res == FR_OK && ofs > bcs; ofs -= bcs) {
+                        clst = next_clust(&fp->obj, clst, 0);
+                        if (clst <= 1) res = FR_INT_ERR;
+                        if (clst == 0xFFFFFFFF) res = FR_DISK_ERR;
+                    }
                 }
                 fp->clust = clst;
                 if (res == FR_OK && ofs % SS(fs)) {    /* Fill sector buffer if not on the sector boundary */
@@ -3596,95 +4217,282 @@ FRESULT f_open (
 /*-----------------------------------------------------------------------*/
 /* Read File                                                             */
 /*-----------------------------------------------------------------------*/
+/* The segments are filled in order as a single transfer. Each segment   */
+/* is read directly when it covers whole sectors and the sectors split   */
+/* between segments are served from the sector cache.                    */
 
-FRESULT f_read (
-    FIL* fp,     /* Pointer to the file object */
-    void* buff,    /* Pointer to data buffer */
-    UINT btr,    /* Number of bytes to read */
-    UINT* br    /* Pointer to number of bytes read */
+static
+FRESULT read_segs (
+    FIL* fp,            /* Pointer to the file object */
+    const FFIOVEC* iov, /* Pointer to the segment table */
+    UINT niov,          /* Number of segments */
+    UINT* br            /* Pointer to number of bytes read */
 )
 {
     FRESULT res;
     FATFS *fs;
     DWORD clst, sect;
     FSIZE_t remain;
-    UINT rcnt, cc, csect;
-    BYTE *rbuff = (BYTE*)buff;
+    UINT btr, rcnt, cc, csect;
+    BYTE *rbuff;
 
 
     *br = 0;    /* Clear read byte counter */
     res = validate(&fp->obj, &fs);                /* Check validity of the file object */
     if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);    /* Check validity */
     if (!(fp->flag & FA_READ)) LEAVE_FF(fs, FR_DENIED); /* Check access mode */
-    remain = fp->obj.objsize - fp->fptr;
-    if (btr > remain) btr = (UINT)remain;        /* Truncate btr by remaining bytes */
-
-    for ( ;  btr;                                /* Repeat until all data read */
-        btr -= rcnt, *br += rcnt, rbuff += rcnt, fp->fptr += rcnt) {
-        if (fp->fptr % SS(fs) == 0) {            /* On the sector boundary? */
-            csect = (UINT)(fp->fptr / SS(fs) & (fs->csize - 1));    /* Sector offset in the cluster */
-            if (csect == 0) {                    /* On the cluster boundary? */
-                if (fp->fptr == 0) {            /* On the top of the file? */
-                    clst = fp->obj.sclust;        /* Follow cluster chain from the origin */
-                } else {                        /* Middle or end of the file */
+
+    for ( ; niov; niov--, iov++) {                /* Repeat for each segment */
+        rbuff = (BYTE*)iov->buf; btr = iov->len;
+        remain = fp->obj.objsize - fp->fptr;
+        if (btr > remain) btr = (UINT)remain;        /* Truncate btr by remaining bytes */
+
+        for ( ;  btr;                                /* Repeat until all data read */
+            btr -= rcnt, *br += rcnt, rbuff += rcnt, fp->fptr += rcnt) {
+            if (fp->fptr % SS(fs) == 0) {            /* On the sector boundary? */
+                csect = (UINT)(fp->fptr / SS(fs) & (fs->csize - 1));    /* Sector offset in the cluster */
+                if (csect == 0) {                    /* On the cluster boundary? */
+                    if (fp->fptr == 0) {            /* On the top of the file? */
+                        clst = fp->obj.sclust;        /* Follow cluster chain from the origin */
+                    } else {                        /* Middle or end of the file */
 #if FF_USE_FASTSEEK
-                    if (fp->cltbl) {
-                        clst = clmt_clust(fp, fp->fptr);    /* Get cluster# from the CLMT */
-                    } else
+                        if (fp->cltbl) {
+                            clst = clmt_clust(fp, fp->fptr);    /* Get cluster# from the CLMT */
+                        } else
 #endif
-                    {
-                        clst = get_fat(&fp->obj, fp->clust);    /* Follow cluster chain on the FAT */
+                        {
+                            clst = next_clust(&fp->obj, fp->clust, 0);    /* Follow cluster chain on the FAT */
+                        }
                     }
+                    if (clst < 2) ABORT(fs, FR_INT_ERR);
+                    if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+                    fp->clust = clst;                /* Update current cluster */
+#if FF_SEEK_INDEX
+                    put_ckpt(fp, clst);
+#endif
                 }
-                if (clst < 2) ABORT(fs, FR_INT_ERR);
-                if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
-                fp->clust = clst;                /* Update current cluster */
-            }
-            sect = clst2sect(fs, fp->clust);    /* Get current sector */
-            if (sect == 0) ABORT(fs, FR_INT_ERR);
-            sect += csect;
-            cc = btr / SS(fs);                    /* When remaining bytes >= sector size, */
-            if (cc > 0) {                        /* Read maximum contiguous sectors directly */
-                if (csect + cc > fs->csize) {    /* Clip at cluster boundary */
-                    cc = fs->csize - csect;
-                }
-                if (disk_read(fs->pdrv, rbuff, sect, cc) != RES_OK) ABORT(fs, FR_DISK_ERR);
+                sect = clst2sect(fs, fp->clust);    /* Get current sector */
+                if (sect == 0) ABORT(fs, FR_INT_ERR);
+                sect += csect;
+                cc = btr / SS(fs);                    /* When remaining bytes >= sector size, */
+                if (cc > 0) {                        /* Read maximum contiguous sectors directly */
+                    if (csect + cc > fs->csize) {    /* Clip at cluster boundary */
+                        cc = fs->csize - csect;
+                    }
+#if FF_USE_ASYNC
+                    if (fp->as_op && !async_owner(fs)) {    /* Start the transfer and leave, it is completed by f_async_poll() */
+                        if (disk_submit(fs->pdrv, rbuff, sect, cc, 0)) ABORT(fs, FR_DISK_ERR);
+                        fp->as_sect = sect; fp->as_cnt = cc;
+                        fs->as_obj = fp;        /* The drive is in use by this file */
+                        LEAVE_FF(fs, FR_OK);
+                    }
+#endif
+                    res = xfer_data(&fp->obj, rbuff, sect, cc, 0);
+                    if (res != FR_OK) ABORT(fs, res);
 #if !FF_FS_READONLY && FF_FS_MINIMIZE <= 2        /* Replace one of the read sectors with cached data if it contains a dirty sector */
 #if FF_FS_TINY
-                if (fs->wflag && fs->winsect - sect < cc) {
-                    MEMCPY(rbuff + ((fs->winsect - sect) * SS(fs)), fs->win, SS(fs));
-                }
+                    if (fs->wflag && fs->winsect - sect < cc) {
+                        MEMCPY(rbuff + ((fs->winsect - sect) * SS(fs)), fs->win, SS(fs));
+                    }
 #else
-                if ((fp->flag & FA_DIRTY) && fp->sect - sect < cc) {
-                    MEMCPY(rbuff + ((fp->sect - sect) * SS(fs)), fp->buf, SS(fs));
-                }
+                    if ((fp->flag & FA_DIRTY) && fp->sect - sect < cc) {
+                        MEMCPY(rbuff + ((fp->sect - sect) * SS(fs)), fp->buf, SS(fs));
+                    }
 #endif
 #endif
-                rcnt = SS(fs) * cc;                /* Number of bytes transferred */
-                continue;
-            }
+                    rcnt = SS(fs) * cc;                /* Number of bytes transferred */
+                    continue;
+                }
 #if !FF_FS_TINY
-            if (fp->sect != sect) {            /* Load data sector if not in cache */
+                if (fp->sect != sect) {            /* Load data sector if not in cache */
 #if !FF_FS_READONLY
-                if (fp->flag & FA_DIRTY) {        /* Write-back dirty sector cache */
-                    if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) ABORT(fs, FR_DISK_ERR);
-                    fp->flag &= (BYTE)~FA_DIRTY;
+                    if (fp->flag & FA_DIRTY) {        /* Write-back dirty sector cache */
+                        res = xfer_data(&fp->obj, fp->buf, fp->sect, 1, 1);
+                        if (res != FR_OK) ABORT(fs, res);
+                        fp->flag &= (BYTE)~FA_DIRTY;
+                    }
+#endif
+                    res = xfer_data(&fp->obj, fp->buf, sect, 1, 0);    /* Fill sector cache */
+                    if (res != FR_OK) ABORT(fs, res);
                 }
 #endif
-                if (disk_read(fs->pdrv, fp->buf, sect, 1) != RES_OK)    ABORT(fs, FR_DISK_ERR);    /* Fill sector cache */
+                fp->sect = sect;
             }
+            rcnt = SS(fs) - (UINT)fp->fptr % SS(fs);    /* Number of bytes left in the sector */
+            if (rcnt > btr) rcnt = btr;                    /* Clip it by btr if needed */
+#if FF_FS_TINY
+            if (move_window(fs, fp->sect) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Move sector window */
+            MEMCPY(rbuff, fs->win + fp->fptr % SS(fs), rcnt);    /* Extract partial sector */
+#else
+            MEMCPY(rbuff, fp->buf + fp->fptr % SS(fs), rcnt);    /* Extract partial sector */
 #endif
-            fp->sect = sect;
         }
-        rcnt = SS(fs) - (UINT)fp->fptr % SS(fs);    /* Number of bytes left in the sector */
-        if (rcnt > btr) rcnt = btr;                    /* Clip it by btr if needed */
+    }
+
+    LEAVE_FF(fs, FR_OK);
+}
+
+
+FRESULT f_read (
+    FIL* fp,     /* Pointer to the file object */
+    void* buff,    /* Pointer to data buffer */
+    UINT btr,    /* Number of bytes to read */
+    UINT* br    /* Pointer to number of bytes read */
+)
+{
+    FFIOVEC iov;
+
+
+    iov.buf = buff; iov.len = btr;
+    return read_segs(fp, &iov, 1, br);
+}
+
+
+FRESULT f_readv (
+    FIL* fp,            /* Pointer to the file object */
+    const FFIOVEC* iov, /* Pointer to the segment table */
+    UINT niov,          /* Number of segments */
+    UINT* br            /* Pointer to number of bytes read */
+)
+{
+    return read_segs(fp, iov, niov, br);
+}
+
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Peek/Consume File Data in the Sector Buffer                           */
+/*-----------------------------------------------------------------------*/
+/* f_peek() returns a pointer to the data at the file pointer in the     */
+/* sector buffer (the window at tiny cfg) and the number of bytes up to  */
+/* the end of the sector. The pointer is valid until the next FatFs call */
+/* on the volume. f_consume() moves the file pointer forward within it.  */
+/* On a sector boundary, f_consume() loads the sector at the file        */
+/* pointer when it is not in the cache, so that the cache follows fptr.  */
+
+static
+DWORD boundary_clust (    /* Cluster# starting at the file pointer on a cluster boundary (0-1:Error, 0xFFFFFFFF:Disk error) */
+    FIL* fp        /* Pointer to the file object */
+)
+{
+    if (fp->fptr == 0) return fp->obj.sclust;    /* On the top of the file */
+#if FF_USE_FASTSEEK
+    if (fp->cltbl) return clmt_clust(fp, fp->fptr);    /* Get cluster# from the CLMT */
+#endif
+    return next_clust(&fp->obj, fp->clust, 0);    /* Follow cluster chain on the FAT */
+}
+
+
+static
+FRESULT load_sect (    /* Load the sector at the file pointer on a sector boundary into the sector cache */
+    FIL* fp,        /* Pointer to the file object */
+    DWORD* rclst    /* Pointer to return the cluster# of the sector */
+)
+{
+    FATFS *fs = fp->obj.fs;
+    DWORD clst, sect;
+    UINT csect;
+#if !FF_FS_TINY
+    FRESULT res;
+#endif
+
+
+    csect = (UINT)(fp->fptr / SS(fs) & (fs->csize - 1));    /* Sector offset in the cluster */
+    clst = fp->clust;
+    if (csect == 0) {                        /* On the cluster boundary? */
+        clst = boundary_clust(fp);
+        if (clst < 2) return FR_INT_ERR;
+        if (clst == 0xFFFFFFFF) return FR_DISK_ERR;
+    }
+    sect = clst2sect(fs, clst);                /* Get the sector */
+    if (sect == 0) return FR_INT_ERR;
+    sect += csect;
+#if !FF_FS_TINY
+    if (fp->sect != sect) {                    /* Load data sector if not in cache */
+#if !FF_FS_READONLY
+        if (fp->flag & FA_DIRTY) {            /* Write-back dirty sector cache */
+            res = xfer_data(&fp->obj, fp->buf, fp->sect, 1, 1);
+            if (res != FR_OK) return res;
+            fp->flag &= (BYTE)~FA_DIRTY;
+        }
+#endif
+        res = xfer_data(&fp->obj, fp->buf, sect, 1, 0);    /* Fill sector cache */
+        if (res != FR_OK) return res;
+    }
+#endif
+    fp->sect = sect;
+    *rclst = clst;
+    return FR_OK;
+}
+
+
+FRESULT f_peek (
+    FIL* fp,            /* Pointer to the file object */
+    const BYTE** ptr,    /* Pointer to return the pointer to the data at the file pointer */
+    UINT* len            /* Pointer to return number of bytes available at *ptr (0:End of file) */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    DWORD clst;
+    FSIZE_t remain;
+    UINT n;
+
+
+    *len = 0;
+    res = validate(&fp->obj, &fs);                /* Check validity of the file object */
+    if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);    /* Check validity */
+    if (!(fp->flag & FA_READ)) LEAVE_FF(fs, FR_DENIED); /* Check access mode */
+    remain = fp->obj.objsize - fp->fptr;
+    if (remain == 0) LEAVE_FF(fs, FR_OK);        /* End of file */
+
+    if (fp->fptr % SS(fs) == 0) {                /* On the sector boundary? Load the sector without moving into it */
+        res = load_sect(fp, &clst);
+        if (res != FR_OK) ABORT(fs, res);
+    }
 #if FF_FS_TINY
-        if (move_window(fs, fp->sect) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Move sector window */
-        MEMCPY(rbuff, fs->win + fp->fptr % SS(fs), rcnt);    /* Extract partial sector */
+    if (move_window(fs, fp->sect) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Move sector window */
+    *ptr = fs->win + fp->fptr % SS(fs);
 #else
-        MEMCPY(rbuff, fp->buf + fp->fptr % SS(fs), rcnt);    /* Extract partial sector */
+    *ptr = fp->buf + fp->fptr % SS(fs);
 #endif
+    n = SS(fs) - (UINT)fp->fptr % SS(fs);        /* Number of bytes left in the sector */
+    if (n > remain) n = (UINT)remain;
+    *len = n;
+
+    LEAVE_FF(fs, FR_OK);
+}
+
+
+FRESULT f_consume (
+    FIL* fp,        /* Pointer to the file object */
+    UINT n            /* Number of bytes to consume (up to the length returned by f_peek) */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    DWORD clst;
+    FSIZE_t remain;
+
+
+    res = validate(&fp->obj, &fs);                /* Check validity of the file object */
+    if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);    /* Check validity */
+    remain = fp->obj.objsize - fp->fptr;
+    if (n > remain || n > SS(fs) - (UINT)fp->fptr % SS(fs)) LEAVE_FF(fs, FR_INVALID_PARAMETER);    /* Beyond the peeked data? */
+
+    if (n && fp->fptr % SS(fs) == 0) {            /* Moving into a new sector? Make sure it is in the sector cache */
+        res = load_sect(fp, &clst);
+        if (res != FR_OK) ABORT(fs, res);
+        if ((fp->fptr / SS(fs) & (fs->csize - 1)) == 0) {    /* Moving into a new cluster? */
+            fp->clust = clst;                    /* Update current cluster */
+#if FF_SEEK_INDEX
+            put_ckpt(fp, clst);
+#endif
+        }
     }
+    fp->fptr += n;
 
     LEAVE_FF(fs, FR_OK);
 }
@@ -3696,19 +4504,22 @@ FRESULT f_read (
 /*-----------------------------------------------------------------------*/
 /* Write File                                                            */
 /*-----------------------------------------------------------------------*/
+/* The segments are written in order as a single transfer. The sectors   */
+/* split between segments are merged in the sector cache.                */
 
-FRESULT f_write (
+static
+FRESULT write_segs (
     FIL* fp,            /* Pointer to the file object */
-    const void* buff,    /* Pointer to the data to be written */
-    UINT btw,            /* Number of bytes to write */
+    const FFIOVEC* iov, /* Pointer to the segment table */
+    UINT niov,          /* Number of segments */
     UINT* bw            /* Pointer to number of bytes written */
 )
 {
     FRESULT res;
     FATFS *fs;
     DWORD clst, sect;
-    UINT wcnt, cc, csect;
-    const BYTE *wbuff = (const BYTE*)buff;
+    UINT btw, wcnt, cc, csect;
+    const BYTE *wbuff;
 
 
     *bw = 0;    /* Clear write byte counter */
@@ -3716,179 +4527,426 @@ FRESULT f_write (
     if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);    /* Check validity */
     if (!(fp->flag & FA_WRITE)) LEAVE_FF(fs, FR_DENIED);    /* Check access mode */
 
-    /* Check fptr wrap-around (file size cannot reach 4 GiB at FAT volume) */
-    if ((!FF_FS_EXFAT || fs->fs_type != FS_EXFAT) && (DWORD)(fp->fptr + btw) < (DWORD)fp->fptr) {
-        btw = (UINT)(0xFFFFFFFF - (DWORD)fp->fptr);
-    }
+    for ( ; niov; niov--, iov++) {            /* Repeat for each segment */
+        wbuff = (const BYTE*)iov->buf; btw = iov->len;
 
-    for ( ;  btw;                            /* Repeat until all data written */
-        btw -= wcnt, *bw += wcnt, wbuff += wcnt, fp->fptr += wcnt, fp->obj.objsize = (fp->fptr > fp->obj.objsize) ? fp->fptr : fp->obj.objsize) {
-        if (fp->fptr % SS(fs) == 0) {        /* On the sector boundary? */
-            csect = (UINT)(fp->fptr / SS(fs)) & (fs->csize - 1);    /* Sector offset in the cluster */
-            if (csect == 0) {                /* On the cluster boundary? */
-                if (fp->fptr == 0) {        /* On the top of the file? */
-                    clst = fp->obj.sclust;    /* Follow from the origin */
-                    if (clst == 0) {        /* If no cluster is allocated, */
-                        clst = create_chain(&fp->obj, 0);    /* create a new cluster chain */
-                    }
-                } else {                    /* On the middle or end of the file */
+        /* Check fptr wrap-around (file size cannot reach 4 GiB at FAT volume) */
+        if ((!FF_FS_EXFAT || fs->fs_type != FS_EXFAT) && (DWORD)(fp->fptr + btw) < (DWORD)fp->fptr) {
+            btw = (UINT)(0xFFFFFFFF - (DWORD)fp->fptr);
+        }
+
+        for ( ;  btw;                            /* Repeat until all data written */
+            btw -= wcnt, *bw += wcnt, wbuff += wcnt, fp->fptr += wcnt, fp->obj.objsize = (fp->fptr > fp->obj.objsize) ? fp->fptr : fp->obj.objsize) {
+            if (fp->fptr % SS(fs) == 0) {        /* On the sector boundary? */
+                csect = (UINT)(fp->fptr / SS(fs)) & (fs->csize - 1);    /* Sector offset in the cluster */
+                if (csect == 0) {                /* On the cluster boundary? */
+                    if (fp->fptr == 0) {        /* On the top of the file? */
+                        clst = fp->obj.sclust;    /* Follow from the origin */
+                        if (clst == 0) {        /* If no cluster is allocated, */
+                            clst = create_chain(&fp->obj, 0);    /* create a new cluster chain */
+                        }
+                    } else {                    /* On the middle or end of the file */
 #if FF_USE_FASTSEEK
-                    if (fp->cltbl) {
-                        clst = clmt_clust(fp, fp->fptr);    /* Get cluster# from the CLMT */
-                    } else
+                        if (fp->cltbl) {
+                            clst = clmt_clust(fp, fp->fptr);    /* Get cluster# from the CLMT */
+                        } else
+#endif
+                        {
+                            clst = next_clust(&fp->obj, fp->clust, 1);    /* Follow or stretch cluster chain on the FAT */
+                        }
+                    }
+                    if (clst == 0) break;        /* Could not allocate a new cluster (disk full) */
+                    if (clst == 1) ABORT(fs, FR_INT_ERR);
+                    if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+                    fp->clust = clst;            /* Update current cluster */
+#if FF_SEEK_INDEX
+                    put_ckpt(fp, clst);
+#endif
+                    if (fp->obj.sclust == 0) {        /* Set start cluster if the first write */
+                        fp->obj.sclust = clst;
+#if FF_FS_CONTIG
+                        fp->obj.n_lead = 1;
 #endif
-                    {
-                        clst = create_chain(&fp->obj, fp->clust);    /* Follow or stretch cluster chain on the FAT */
                     }
                 }
-                if (clst == 0) break;        /* Could not allocate a new cluster (disk full) */
-                if (clst == 1) ABORT(fs, FR_INT_ERR);
-                if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
-                fp->clust = clst;            /* Update current cluster */
-                if (fp->obj.sclust == 0) fp->obj.sclust = clst;    /* Set start cluster if the first write */
-            }
 #if FF_FS_TINY
-            if (fs->winsect == fp->sect && sync_window(fs) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Write-back sector cache */
+                if (fs->winsect == fp->sect && sync_window(fs) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Write-back sector cache */
 #else
-            if (fp->flag & FA_DIRTY) {        /* Write-back sector cache */
-                if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) ABORT(fs, FR_DISK_ERR);
-                fp->flag &= (BYTE)~FA_DIRTY;
-            }
-#endif
-            sect = clst2sect(fs, fp->clust);    /* Get current sector */
-            if (sect == 0) ABORT(fs, FR_INT_ERR);
-            sect += csect;
-            cc = btw / SS(fs);                /* When remaining bytes >= sector size, */
-            if (cc > 0) {                    /* Write maximum contiguous sectors directly */
-                if (csect + cc > fs->csize) {    /* Clip at cluster boundary */
-                    cc = fs->csize - csect;
+                if (fp->flag & FA_DIRTY) {        /* Write-back sector cache */
+                    res = xfer_data(&fp->obj, fp->buf, fp->sect, 1, 1);
+                    if (res != FR_OK) ABORT(fs, res);
+                    fp->flag &= (BYTE)~FA_DIRTY;
                 }
-                if (disk_write(fs->pdrv, wbuff, sect, cc) != RES_OK) ABORT(fs, FR_DISK_ERR);
+#endif
+                sect = clst2sect(fs, fp->clust);    /* Get current sector */
+                if (sect == 0) ABORT(fs, FR_INT_ERR);
+                sect += csect;
+                cc = btw / SS(fs);                /* When remaining bytes >= sector size, */
+                if (cc > 0) {                    /* Write maximum contiguous sectors directly */
+                    if (csect + cc > fs->csize) {    /* Clip at cluster boundary */
+                        cc = fs->csize - csect;
+                    }
+#if FF_USE_ASYNC
+                    if (fp->as_op && !async_owner(fs)) {    /* Start the transfer and leave, it is completed by f_async_poll() */
+                        if (disk_submit(fs->pdrv, (BYTE*)wbuff, sect, cc, 1)) ABORT(fs, FR_DISK_ERR);
+                        fp->as_sect = sect; fp->as_cnt = cc;
+                        fs->as_obj = fp;        /* The drive is in use by this file */
+                        fp->flag |= FA_MODIFIED;
+                        LEAVE_FF(fs, FR_OK);
+                    }
+#endif
+                    res = xfer_data(&fp->obj, (BYTE*)wbuff, sect, cc, 1);
+                    if (res != FR_OK) ABORT(fs, res);
 #if FF_FS_MINIMIZE <= 2
 #if FF_FS_TINY
-                if (fs->winsect - sect < cc) {    /* Refill sector cache if it gets invalidated by the direct write */
-                    MEMCPY(fs->win, wbuff + ((fs->winsect - sect) * SS(fs)), SS(fs));
-                    fs->wflag = 0;
+                    if (fs->winsect - sect < cc) {    /* Refill sector cache if it gets invalidated by the direct write */
+                        MEMCPY(fs->win, wbuff + ((fs->winsect - sect) * SS(fs)), SS(fs));
+                        fs->wflag = 0;
+                    }
+#else
+                    if (fp->sect - sect < cc) { /* Refill sector cache if it gets invalidated by the direct write */
+                        MEMCPY(fp->buf, wbuff + ((fp->sect - sect) * SS(fs)), SS(fs));
+                        fp->flag &= (BYTE)~FA_DIRTY;
+                    }
+#endif
+#endif
+                    wcnt = SS(fs) * cc;        /* Number of bytes transferred */
+                    continue;
+                }
+#if FF_FS_TINY
+                if (fp->fptr >= fp->obj.objsize) {    /* Avoid silly cache filling on the growing edge */
+                    if (sync_window(fs) != FR_OK) ABORT(fs, FR_DISK_ERR);
+                    fs->winsect = sect;
                 }
 #else
-                if (fp->sect - sect < cc) { /* Refill sector cache if it gets invalidated by the direct write */
-                    MEMCPY(fp->buf, wbuff + ((fp->sect - sect) * SS(fs)), SS(fs));
-                    fp->flag &= (BYTE)~FA_DIRTY;
+                if (fp->sect != sect &&         /* Fill sector cache with file data */
+                    fp->fptr < fp->obj.objsize &&
+                    (res = xfer_data(&fp->obj, fp->buf, sect, 1, 0)) != FR_OK) {
+                        ABORT(fs, res);
                 }
 #endif
-#endif
-                wcnt = SS(fs) * cc;        /* Number of bytes transferred */
-                continue;
+                fp->sect = sect;
             }
+            wcnt = SS(fs) - (UINT)fp->fptr % SS(fs);    /* Number of bytes left in the sector */
+            if (wcnt > btw) wcnt = btw;                    /* Clip it by btw if needed */
 #if FF_FS_TINY
-            if (fp->fptr >= fp->obj.objsize) {    /* Avoid silly cache filling on the growing edge */
-                if (sync_window(fs) != FR_OK) ABORT(fs, FR_DISK_ERR);
-                fs->winsect = sect;
+            if (move_window(fs, fp->sect) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Move sector window */
+            MEMCPY(fs->win + fp->fptr % SS(fs), wbuff, wcnt);    /* Fit data to the sector */
+            fs->wflag = 1;
+#else
+            MEMCPY(fp->buf + fp->fptr % SS(fs), wbuff, wcnt);    /* Fit data to the sector */
+            fp->flag |= FA_DIRTY;
+#endif
+        }
+        if (btw) break;                         /* Disk full? */
+    }
+
+    fp->flag |= FA_MODIFIED;                /* Set file change flag */
+
+    LEAVE_FF(fs, FR_OK);
+}
+
+
+FRESULT f_write (
+    FIL* fp,            /* Pointer to the file object */
+    const void* buff,    /* Pointer to the data to be written */
+    UINT btw,            /* Number of bytes to write */
+    UINT* bw            /* Pointer to number of bytes written */
+)
+{
+    FFIOVEC iov;
+
+
+    iov.buf = (void*)buff; iov.len = btw;
+    return write_segs(fp, &iov, 1, bw);
+}
+
+
+FRESULT f_writev (
+    FIL* fp,            /* Pointer to the file object */
+    const FFIOVEC* iov, /* Pointer to the segment table */
+    UINT niov,          /* Number of segments */
+    UINT* bw            /* Pointer to number of bytes written */
+)
+{
+    return write_segs(fp, iov, niov, bw);
+}
+
+
+/* Resumable write: the data described in the step context is written up */
+/* to nsect sectors per call. The write is finished when st->btx gets 0.  */
+
+FRESULT f_write_step (
+    FIL* fp,            /* Pointer to the file object */
+    FFSTEP* st,            /* Pointer to the step context (buf, btx and bx are set by the caller) */
+    UINT nsect            /* Maximum number of sectors to be written in this call */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    FFIOVEC iov;
+    DWORD len;
+    UINT bw;
+
+
+    res = validate(&fp->obj, &fs);        /* Check validity of the file object */
+    if (res != FR_OK) LEAVE_FF(fs, res);
+#if FF_FS_REENTRANT
+    unlock_fs(fs, FR_OK);                /* Unlock volume (write_segs() locks it again) */
+#endif
+    if (nsect == 0) nsect = 1;
+    if (nsect > (UINT)-1 / SS(fs)) nsect = (UINT)-1 / SS(fs);    /* Keep the span in range of UINT */
+    len = (DWORD)(SS(fs) - fp->fptr % SS(fs)) + (DWORD)(nsect - 1) * SS(fs);    /* Up to nsect sector boundaries */
+    if (len > st->btx) len = st->btx;
+    iov.buf = (void*)st->buf;
+    iov.len = (UINT)len;
+    res = write_segs(fp, &iov, 1, &bw);
+    st->buf += bw; st->btx -= bw; st->bx += bw;
+    if (res == FR_OK && bw < iov.len) st->btx = 0;    /* Finish at disk full */
+    return res;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Synchronize the File - Flush the file and update its directory entry  */
+/*-----------------------------------------------------------------------*/
+/* The directory entry is updated on the window and the volume is not    */
+/* synchronized here.                                                    */
+
+static
+FRESULT sync_file (
+    FIL* fp        /* Pointer to the file object (modified) */
+)
+{
+    FRESULT res;
+    FATFS *fs = fp->obj.fs;
+    DWORD tm;
+    BYTE *dir;
+
+
+#if !FF_FS_TINY
+    if (fp->flag & FA_DIRTY) {    /* Write-back cached data if needed */
+        if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) return FR_DISK_ERR;
+        fp->flag &= (BYTE)~FA_DIRTY;
+    }
+#endif
+    /* Update the directory entry */
+    tm = GET_FATTIME();                /* Modified time */
+#if FF_FS_EXFAT
+    if (fs->fs_type == FS_EXFAT) {
+        res = fill_first_frag(&fp->obj);    /* Fill first fragment on the FAT if needed */
+        if (res == FR_OK) {
+            res = fill_last_frag(&fp->obj, fp->clust, 0xFFFFFFFF);    /* Fill last fragment on the FAT if needed */
+        }
+        if (res == FR_OK) {
+            DIR dj;
+            DEF_NAMBUF
+
+            INIT_NAMBUF(fs);
+            res = load_obj_xdir(&dj, &fp->obj);    /* Load directory entry block */
+            if (res == FR_OK) {
+                fs->dirbuf[XDIR_Attr] |= AM_ARC;                /* Set archive attribute to indicate that the file has been changed */
+                fs->dirbuf[XDIR_GenFlags] = fp->obj.stat | 1;    /* Update file allocation information */
+                STDWORD(fs->dirbuf + XDIR_FstClus, fp->obj.sclust);
+                STQWORD(fs->dirbuf + XDIR_FileSize, fp->obj.objsize);
+                STQWORD(fs->dirbuf + XDIR_ValidFileSize, fp->obj.objsize);
+                STDWORD(fs->dirbuf + XDIR_ModTime, tm);        /* Update modified time */
+                fs->dirbuf[XDIR_ModTime10] = 0;
+                STDWORD(fs->dirbuf + XDIR_AccTime, 0);
+                res = store_xdir(&dj);    /* Restore it to the directory */
             }
+            FREE_NAMBUF();
+        }
+    } else
+#endif
+    {
+        res = move_window(fs, fp->dir_sect);
+        if (res == FR_OK) {
+            dir = fp->dir_ptr;
+            dir[DIR_Attr] |= AM_ARC;                        /* Set archive attribute to indicate that the file has been changed */
+            st_clust(fp->obj.fs, dir, fp->obj.sclust);        /* Update file allocation information  */
+            STDWORD(dir + DIR_FileSize, (DWORD)fp->obj.objsize);    /* Update file size */
+            STDWORD(dir + DIR_ModTime, tm);                /* Update modified time */
+            STWORD(dir + DIR_LstAccDate, 0);
+            fs->wflag = 1;
+        }
+    }
+    if (res == FR_OK) {
+        fp->flag &= (BYTE)~FA_MODIFIED;
+#if FF_USE_DATASYNC
+        fp->dir_sclust = fp->obj.sclust;
+        fp->dir_size = fp->obj.objsize;
+#endif
+    }
+    return res;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Synchronize the File                                                  */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_sync (
+    FIL* fp        /* Pointer to the file object */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+
+
+    res = validate(&fp->obj, &fs);    /* Check validity of the file object */
+    if (res == FR_OK) {
+        if (fp->flag & FA_MODIFIED) {    /* Is there any change to the file? */
+            res = sync_file(fp);        /* Update the directory entry */
+            if (res == FR_OK) res = sync_fs(fs);    /* Restore it to the directory */
+        }
+#if FF_FS_RECLAIM
+        if (res == FR_OK && fs->rcl_clst[0] != 0) {    /* Free a slice of the chains pending to be removed */
+            res = reclaim_chain(fs, RECLAIM_SLICE);
+            if (res == FR_OK) res = sync_fs(fs);
+        }
+#endif
+#if FF_APPEND_CACHE
+        if (res == FR_OK) put_acache(fp);    /* Register the chain end */
+#endif
+    }
+
+    LEAVE_FF(fs, res);
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Synchronize Multiple Files on a Volume                                */
+/*-----------------------------------------------------------------------*/
+/* The directory entries are updated in order of the directory sector    */
+/* and the volume is synchronized only once at end of the function.      */
+
+FRESULT f_sync_many (
+    FIL* const fp[],    /* Pointer to the array of the file objects on the same volume */
+    UINT n                /* Number of the file objects */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    UINT i, j, k;
+    DWORD ks, s;
+
+
+    if (n == 0) return FR_OK;
+    if (!fp[0]) return FR_INVALID_OBJECT;    /* Check the first file object the same way as the others */
+    res = validate(&fp[0]->obj, &fs);    /* Check validity of the first file object and lock the volume */
+    for (i = 1; res == FR_OK && i < n; i++) {    /* Check if all the file objects are on the volume */
+        if (!fp[i] || fp[i]->obj.fs != fs || fp[i]->obj.id != fs->id) res = FR_INVALID_OBJECT;
+    }
+    if (res == FR_OK) {
+        for (k = 0; k < n; k++) {    /* Process the modified files in order of the directory entry location */
+            j = n; ks = 0;
+            for (i = 0; i < n; i++) {
+                if (!(fp[i]->flag & FA_MODIFIED)) continue;
+#if FF_FS_EXFAT
+                s = (fs->fs_type == FS_EXFAT) ? fp[i]->obj.c_ofs : fp[i]->dir_sect;
 #else
-            if (fp->sect != sect &&         /* Fill sector cache with file data */
-                fp->fptr < fp->obj.objsize &&
-                disk_read(fs->pdrv, fp->buf, sect, 1) != RES_OK) {
-                    ABORT(fs, FR_DISK_ERR);
-            }
+                s = fp[i]->dir_sect;
 #endif
-            fp->sect = sect;
+                if (j == n || s < ks) {
+                    j = i; ks = s;
+                }
+            }
+            if (j == n) break;    /* No modified file left */
+            res = sync_file(fp[j]);    /* Update the directory entry (FA_MODIFIED is cleared) */
+            if (res != FR_OK) break;
         }
-        wcnt = SS(fs) - (UINT)fp->fptr % SS(fs);    /* Number of bytes left in the sector */
-        if (wcnt > btw) wcnt = btw;                    /* Clip it by btw if needed */
-#if FF_FS_TINY
-        if (move_window(fs, fp->sect) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Move sector window */
-        MEMCPY(fs->win + fp->fptr % SS(fs), wbuff, wcnt);    /* Fit data to the sector */
-        fs->wflag = 1;
-#else
-        MEMCPY(fp->buf + fp->fptr % SS(fs), wbuff, wcnt);    /* Fit data to the sector */
-        fp->flag |= FA_DIRTY;
+#if FF_FS_RECLAIM
+        if (res == FR_OK && fs->rcl_clst[0] != 0) {    /* Free a slice of the chains pending to be removed */
+            res = reclaim_chain(fs, RECLAIM_SLICE);
+        }
+#endif
+        if (res == FR_OK) res = sync_fs(fs);    /* Flush the directory sectors and the FAT */
+#if FF_APPEND_CACHE
+        for (i = 0; res == FR_OK && i < n; i++) put_acache(fp[i]);    /* Register the chain ends */
 #endif
     }
 
-    fp->flag |= FA_MODIFIED;                /* Set file change flag */
-
-    LEAVE_FF(fs, FR_OK);
+    LEAVE_FF(fs, res);
 }
 
 
 
-
+#if FF_USE_DATASYNC
 /*-----------------------------------------------------------------------*/
-/* Synchronize the File                                                  */
+/* Synchronize the File Data                                             */
 /*-----------------------------------------------------------------------*/
+/* Same as f_sync() but the directory entry is left unchanged (and the   */
+/* file remains modified) while the file size and the allocation are     */
+/* the same as those recorded in the directory entry.                    */
 
-FRESULT f_sync (
+FRESULT f_datasync (
     FIL* fp        /* Pointer to the file object */
 )
 {
     FRESULT res;
     FATFS *fs;
-    DWORD tm;
-    BYTE *dir;
 
 
     res = validate(&fp->obj, &fs);    /* Check validity of the file object */
-    if (res == FR_OK) {
-        if (fp->flag & FA_MODIFIED) {    /* Is there any change to the file? */
+    if (res == FR_OK && (fp->flag & FA_MODIFIED)) {    /* Is there any change to the file? */
+        if (fp->obj.objsize != fp->dir_size || fp->obj.sclust != fp->dir_sclust
+#if FF_FS_EXFAT
+            || fp->obj.stat == 3 || fp->obj.n_frag != 0        /* exFAT: Has the chain status been changed? */
+#endif
+            ) {
+            res = sync_file(fp);    /* Directory entry needs to be updated */
+        } else {
 #if !FF_FS_TINY
             if (fp->flag & FA_DIRTY) {    /* Write-back cached data if needed */
                 if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) LEAVE_FF(fs, FR_DISK_ERR);
                 fp->flag &= (BYTE)~FA_DIRTY;
             }
 #endif
-            /* Update the directory entry */
-            tm = GET_FATTIME();                /* Modified time */
-#if FF_FS_EXFAT
-            if (fs->fs_type == FS_EXFAT) {
-                res = fill_first_frag(&fp->obj);    /* Fill first fragment on the FAT if needed */
-                if (res == FR_OK) {
-                    res = fill_last_frag(&fp->obj, fp->clust, 0xFFFFFFFF);    /* Fill last fragment on the FAT if needed */
-                }
-                if (res == FR_OK) {
-                    DIR dj;
-                    DEF_NAMBUF
+        }
+        if (res == FR_OK) res = sync_fs(fs);    /* Flush the FAT and the disk cache */
+    }
 
-                    INIT_NAMBUF(fs);
-                    res = load_obj_xdir(&dj, &fp->obj);    /* Load directory entry block */
-                    if (res == FR_OK) {
-                        fs->dirbuf[XDIR_Attr] |= AM_ARC;                /* Set archive attribute to indicate that the file has been changed */
-                        fs->dirbuf[XDIR_GenFlags] = fp->obj.stat | 1;    /* Update file allocation information */
-                        STDWORD(fs->dirbuf + XDIR_FstClus, fp->obj.sclust);
-                        STQWORD(fs->dirbuf + XDIR_FileSize, fp->obj.objsize);
-                        STQWORD(fs->dirbuf + XDIR_ValidFileSize, fp->obj.objsize);
-                        STDWORD(fs->dirbuf + XDIR_ModTime, tm);        /* Update modified time */
-                        fs->dirbuf[XDIR_ModTime10] = 0;
-                        STDWORD(fs->dirbuf + XDIR_AccTime, 0);
-                        res = store_xdir(&dj);    /* Restore it to the directory */
-                        if (res == FR_OK) {
-                            res = sync_fs(fs);
-                            fp->flag &= (BYTE)~FA_MODIFIED;
-                        }
-                    }
-                    FREE_NAMBUF();
-                }
-            } else
+    LEAVE_FF(fs, res);
+}
 #endif
-            {
-                res = move_window(fs, fp->dir_sect);
-                if (res == FR_OK) {
-                    dir = fp->dir_ptr;
-                    dir[DIR_Attr] |= AM_ARC;                        /* Set archive attribute to indicate that the file has been changed */
-                    st_clust(fp->obj.fs, dir, fp->obj.sclust);        /* Update file allocation information  */
-                    STDWORD(dir + DIR_FileSize, (DWORD)fp->obj.objsize);    /* Update file size */
-                    STDWORD(dir + DIR_ModTime, tm);                /* Update modified time */
-                    STWORD(dir + DIR_LstAccDate, 0);
-                    fs->wflag = 1;
-                    res = sync_fs(fs);                    /* Restore it to the directory */
-                    fp->flag &= (BYTE)~FA_MODIFIED;
-                }
-            }
-        }
+
+
+
+#if FF_FS_RECLAIM
+/*-----------------------------------------------------------------------*/
+/* Free a Slice of the Removed Cluster Chains                            */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_reclaim_step (
+    const TCHAR* path,    /* Path name of the logical drive number */
+    DWORD budget,        /* Maximum number of clusters to be freed */
+    UINT* npend            /* Pointer to a variable to return number of chains still pending (null:not needed) */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    UINT i;
+
+
+    res = find_volume(&path, &fs, FA_WRITE);    /* Get logical drive */
+    if (res == FR_OK && fs->rcl_clst[0] != 0) {
+        res = reclaim_chain(fs, budget);        /* Free the clusters */
+        if (res == FR_OK) res = sync_fs(fs);
+    }
+    if (res == FR_OK && npend) {
+        for (i = 0; i < FF_FS_RECLAIM && fs->rcl_clst[i] != 0; i++) ;
+        *npend = i;
     }
 
     LEAVE_FF(fs, res);
 }
+#endif
 
 #endif /* !FF_FS_READONLY */
 
@@ -3930,6 +4988,146 @@ FRESULT f_close (
 
 
 
+#if FF_USE_ASYNC
+/*-----------------------------------------------------------------------*/
+/* Asynchronous Read/Write                                               */
+/*-----------------------------------------------------------------------*/
+/* The transfer runs in f_read()/f_write() until it reaches a run of     */
+/* whole sectors, which is submitted to the disk with disk_submit() and  */
+/* completed later by f_async_poll(). The caller can work on other data  */
+/* while the sectors are in flight.                                      */
+
+static
+FRESULT async_step (
+    FIL* fp        /* Pointer to the file object */
+)
+{
+    FRESULT res;
+    FFIOVEC iov;
+    UINT n;
+
+
+    iov.buf = fp->as_buf; iov.len = fp->as_btx;
+#if !FF_FS_READONLY
+    if (fp->as_op == 2) {
+        res = write_segs(fp, &iov, 1, &n);
+    } else
+#endif
+    {
+        res = read_segs(fp, &iov, 1, &n);
+    }
+    fp->as_buf += n; fp->as_btx -= n; *fp->as_bx += n;
+    if (res != FR_OK || fp->as_cnt == 0) fp->as_op = 0;    /* Finished, failed or stopped at end of file or disk full */
+    return res;
+}
+
+
+FRESULT f_read_async (
+    FIL* fp,     /* Pointer to the file object */
+    void* buff,    /* Pointer to data buffer (must be kept until the transfer is finished) */
+    UINT btr,    /* Number of bytes to read */
+    UINT* br    /* Pointer to number of bytes read (updated until the transfer is finished) */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+
+
+    *br = 0;
+    res = validate(&fp->obj, &fs);        /* Check validity of the file object */
+    if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);
+    if (fp->as_op) LEAVE_FF(fs, FR_DENIED);    /* A transfer is in progress */
+    fp->as_op = 1; fp->as_buf = (BYTE*)buff; fp->as_btx = btr; fp->as_bx = br;
+#if FF_FS_REENTRANT
+    unlock_fs(fs, FR_OK);                /* Unlock volume */
+#endif
+    return async_step(fp);
+}
+
+
+#if !FF_FS_READONLY
+FRESULT f_write_async (
+    FIL* fp,            /* Pointer to the file object */
+    const void* buff,    /* Pointer to the data to be written (must be kept until the transfer is finished) */
+    UINT btw,            /* Number of bytes to write */
+    UINT* bw            /* Pointer to number of bytes written (updated until the transfer is finished) */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+
+
+    *bw = 0;
+    res = validate(&fp->obj, &fs);        /* Check validity of the file object */
+    if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);
+    if (fp->as_op) LEAVE_FF(fs, FR_DENIED);    /* A transfer is in progress */
+    fp->as_op = 2; fp->as_buf = (BYTE*)buff; fp->as_btx = btw; fp->as_bx = bw;
+#if FF_FS_REENTRANT
+    unlock_fs(fs, FR_OK);                /* Unlock volume */
+#endif
+    return async_step(fp);
+}
+#endif
+
+
+FRESULT f_async_poll (
+    FIL* fp        /* Pointer to the file object */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    UINT cc, n;
+    int st;
+
+
+    res = validate(&fp->obj, &fs);        /* Check validity of the file object */
+    if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);
+    cc = fp->as_cnt;
+    if (cc == 0) LEAVE_FF(fs, FR_OK);    /* No transfer in flight */
+    st = disk_poll(fs->pdrv);
+    if (st > 0) LEAVE_FF(fs, FR_OK);    /* In progress */
+    fp->as_cnt = 0;
+    fs->as_obj = 0;                        /* The drive is free */
+    if (st < 0) {                        /* Failed */
+        fp->as_op = 0;
+        ABORT(fs, FR_DISK_ERR);
+    }
+#if !FF_FS_READONLY && FF_FS_MINIMIZE <= 2
+#if FF_FS_TINY
+    if (fs->winsect - fp->as_sect < cc) {
+        if (fp->as_op == 2) {            /* Refill sector cache if it gets invalidated by the write */
+            MEMCPY(fs->win, fp->as_buf + ((fs->winsect - fp->as_sect) * SS(fs)), SS(fs));
+            fs->wflag = 0;
+        } else if (fs->wflag) {            /* Replace one of the read sectors with cached data if it contains a dirty sector */
+            MEMCPY(fp->as_buf + ((fs->winsect - fp->as_sect) * SS(fs)), fs->win, SS(fs));
+        }
+    }
+#else
+    if (fp->sect - fp->as_sect < cc) {
+        if (fp->as_op == 2) {            /* Refill sector cache if it gets invalidated by the write */
+            MEMCPY(fp->buf, fp->as_buf + ((fp->sect - fp->as_sect) * SS(fs)), SS(fs));
+            fp->flag &= (BYTE)~FA_DIRTY;
+        } else if (fp->flag & FA_DIRTY) {    /* Replace one of the read sectors with cached data if it contains a dirty sector */
+            MEMCPY(fp->as_buf + ((fp->sect - fp->as_sect) * SS(fs)), fp->buf, SS(fs));
+        }
+    }
+#endif
+#endif
+    n = SS(fs) * cc;                    /* Number of bytes transferred */
+    fp->fptr += n;
+    if (fp->fptr > fp->obj.objsize) fp->obj.objsize = fp->fptr;    /* Update file size at write */
+    fp->as_buf += n; fp->as_btx -= n; *fp->as_bx += n;
+#if FF_FS_REENTRANT
+    unlock_fs(fs, FR_OK);                /* Unlock volume */
+#endif
+    return async_step(fp);                /* Continue the transfer */
+}
+
+#endif /* FF_USE_ASYNC */
+
+
+
+
 #if FF_FS_RPATH >= 1
 /*-----------------------------------------------------------------------*/
 /* Change Current Directory or Current Drive, Get Current Directory      */
@@ -4120,7 +5318,7 @@ FRESULT f_lseek (
                     tcl = cl; ncl = 0; ulen += 2;    /* Top, length and used items */
                     do {
                         pcl = cl; ncl++;
-                        cl = get_fat(&fp->obj, cl);
+                        cl = next_clust(&fp->obj, cl, 0);
                         if (cl <= 1) ABORT(fs, FR_INT_ERR);
                         if (cl == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
                     } while (cl == pcl + 1);
@@ -4185,10 +5383,24 @@ FRESULT f_lseek (
                     if (clst == 1) ABORT(fs, FR_INT_ERR);
                     if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
                     fp->obj.sclust = clst;
+#if FF_FS_CONTIG
+                    fp->obj.n_lead = 1;
+#endif
                 }
 #endif
                 fp->clust = clst;
             }
+#if FF_SEEK_INDEX
+            nsect = (DWORD)((fp->fptr + ofs - 1) / bcs) >> fp->ck_shift;    /* Last checkpoint before the target cluster */
+            if (nsect > fp->ck_n) nsect = fp->ck_n;
+            if (nsect > 0 && ((FSIZE_t)nsect << fp->ck_shift) * bcs > fp->fptr) {    /* Is it ahead of the start point? */
+                ofs += fp->fptr;
+                fp->fptr = ((FSIZE_t)nsect << fp->ck_shift) * bcs;    /* Start from the checkpoint */
+                ofs -= fp->fptr;
+                fp->clust = clst = fp->ck_clst[nsect - 1];
+            }
+            nsect = 0;
+#endif
             if (clst != 0) {
                 while (ofs > bcs) {                        /* Cluster following loop */
                     ofs -= bcs; fp->fptr += bcs;
@@ -4198,18 +5410,21 @@ FRESULT f_lseek (
                             fp->obj.objsize = fp->fptr;
                             fp->flag |= FA_MODIFIED;
                         }
-                        clst = create_chain(&fp->obj, clst);    /* Follow chain with forceed stretch */
+                        clst = next_clust(&fp->obj, clst, 1);    /* Follow chain with forceed stretch */
                         if (clst == 0) {                /* Clip file size in case of disk full */
                             ofs = 0; break;
                         }
                     } else
 #endif
                     {
-                        clst = get_fat(&fp->obj, clst);    /* Follow cluster chain if not in write mode */
+                        clst = next_clust(&fp->obj, clst, 0);    /* Follow cluster chain if not in write mode */
                     }
                     if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
                     if (clst <= 1 || clst >= fs->n_fatent) ABORT(fs, FR_INT_ERR);
                     fp->clust = clst;
+#if FF_SEEK_INDEX
+                    put_ckpt(fp, clst);
+#endif
                 }
                 fp->fptr += ofs;
                 if (ofs % SS(fs)) {
@@ -4242,6 +5457,90 @@ FRESULT f_lseek (
 
 
 
+#if FF_USE_FASTSEEK
+/*-----------------------------------------------------------------------*/
+/* Get Physical Extents of the File                                      */
+/*-----------------------------------------------------------------------*/
+/* The cluster chain is followed once in the same way as CREATE_LINKMAP  */
+/* and each run of contiguous clusters is stored as a sector range. The  */
+/* ranges cover the file data up to the file size.                       */
+
+FRESULT f_getextents (
+    FIL* fp,        /* Pointer to the file object */
+    FFEXTENT* ext,    /* Pointer to the extent table to store the runs */
+    UINT n,            /* Number of items in the extent table */
+    UINT* count        /* Pointer to number of runs of the file */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    DWORD cl, pcl, tcl, ncl, nclst, nsect;
+    FSIZE_t ofs;
+    UINT i;
+
+
+    *count = 0;
+    res = validate(&fp->obj, &fs);        /* Check validity of the file object */
+    if (res == FR_OK) res = (FRESULT)fp->err;
+#if !FF_FS_READONLY
+#if FF_FS_EXFAT
+    if (res == FR_OK && fs->fs_type == FS_EXFAT) {
+        res = fill_last_frag(&fp->obj, fp->clust, 0xFFFFFFFF);    /* Fill last fragment on the FAT if needed */
+    }
+#endif
+#if FF_FS_TINY
+    if (res == FR_OK) res = sync_window(fs);    /* Flush file data in the window to the device */
+#else
+    if (res == FR_OK && (fp->flag & FA_DIRTY)) {    /* Flush cached file data to the device */
+        if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) res = FR_DISK_ERR;
+        fp->flag &= (BYTE)~FA_DIRTY;
+    }
+#endif
+#endif
+    if (res != FR_OK) LEAVE_FF(fs, res);
+
+    i = 0; ofs = 0;
+    if (fp->obj.objsize > 0) {
+        nclst = (DWORD)((fp->obj.objsize - 1) / SS(fs) / fs->csize) + 1;    /* Number of clusters with file data */
+        nsect = (DWORD)((fp->obj.objsize - 1) / SS(fs)) + 1;                /* Number of sectors with file data */
+        cl = fp->obj.sclust;    /* Origin of the chain */
+        do {
+            /* Get a fragment */
+            tcl = cl; ncl = 0;
+#if FF_FS_EXFAT
+            if (fp->obj.stat == 2) {    /* Contiguous object without FAT chain */
+                ncl = nclst; nclst = 0;
+            } else
+#endif
+            {
+                do {
+                    pcl = cl; ncl++;
+                    if (--nclst == 0) break;    /* End of the file data? */
+                    cl = next_clust(&fp->obj, cl, 0);
+                    if (cl <= 1) ABORT(fs, FR_INT_ERR);
+                    if (cl == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+                } while (cl == pcl + 1);
+            }
+            if (i < n) {        /* Store the fragment as a sector range */
+                ext[i].ofs = ofs;
+                ext[i].sect = clst2sect(fs, tcl);
+                if (ext[i].sect == 0) ABORT(fs, FR_INT_ERR);
+                ext[i].nsect = (ncl * fs->csize < nsect) ? ncl * fs->csize : nsect;
+            }
+            i++;
+            ofs += (FSIZE_t)ncl * fs->csize * SS(fs);
+            nsect -= (ncl * fs->csize < nsect) ? ncl * fs->csize : nsect;
+        } while (nclst > 0);    /* Repeat until end of the file data */
+    }
+    *count = i;        /* Number of runs */
+
+    LEAVE_FF(fs, i <= n ? FR_OK : FR_NOT_ENOUGH_CORE);
+}
+
+#endif    /* FF_USE_FASTSEEK */
+
+
+
 #if FF_FS_MINIMIZE <= 1
 /*-----------------------------------------------------------------------*/
 /* Create a Directory Object                                             */
@@ -4287,6 +5586,9 @@ FRESULT f_opendir (
             }
             if (res == FR_OK) {
                 dp->obj.id = fs->id;
+#if FF_FS_REENTRANT == 2
+                dp->obj.xfer = 0;
+#endif
                 res = dir_sdi(dp, 0);            /* Rewind directory */
 #if FF_FS_LOCK != 0
                 if (res == FR_OK) {
@@ -4464,6 +5766,49 @@ FRESULT f_stat (
 
 
 #if !FF_FS_READONLY
+#if FF_FS_RECLAIM
+/*-----------------------------------------------------------------------*/
+/* Count the Clusters Pending to be Freed                                */
+/*-----------------------------------------------------------------------*/
+
+/* The number of clusters in each pending chain is given by the caller of  */
+/* release_chain() and kept up to date by reclaim_chain(), so the chains   */
+/* are followed only if the number was not known when they were deferred. */
+
+static
+FRESULT count_pending (
+    FATFS* fs,        /* Filesystem object */
+    DWORD* nclst    /* Number of free clusters to be added to */
+)
+{
+    FFOBJID obj;
+    DWORD clst, stat, n;
+    UINT i;
+
+
+    obj.fs = fs;
+    for (i = 0; i < FF_FS_RECLAIM && fs->rcl_clst[i] != 0; i++) {
+        if (fs->rcl_ncl[i] == 0xFFFFFFFF) {    /* Count the chain if not known */
+            clst = fs->rcl_clst[i]; n = 0;
+            do {
+                stat = get_fat(&obj, clst);
+                if (stat == 0xFFFFFFFF) return FR_DISK_ERR;
+                if (stat == 1) return FR_INT_ERR;
+                if (stat == 0) break;
+                n++;
+                clst = stat;
+            } while (clst < fs->n_fatent);
+            fs->rcl_ncl[i] = n;
+        }
+        *nclst += fs->rcl_ncl[i];
+    }
+    return FR_OK;
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Get Number of Free Clusters                                           */
 /*-----------------------------------------------------------------------*/
@@ -4545,6 +5890,9 @@ FRESULT f_getfree (
             fs->free_clst = nfree;    /* Now free_clst is valid */
             fs->fsi_flag |= 1;        /* FAT32: FSInfo is to be updated */
         }
+#if FF_FS_RECLAIM
+        if (res == FR_OK) res = count_pending(fs, nclst);    /* Count the clusters pending to be freed as free */
+#endif
     }
 
     LEAVE_FF(fs, res);
@@ -4553,6 +5901,75 @@ FRESULT f_getfree (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Get Number of Free Clusters in Steps                                  */
+/*-----------------------------------------------------------------------*/
+/* The FAT (allocation bitmap at exFAT) is scanned up to nsect sectors   */
+/* per call. The scan starts when st->clst is 0 and it is finished when  */
+/* st->clst gets 0 again, then the result is stored to *nclst. The scan  */
+/* starts over when the FAT is changed or the volume is remounted.       */
+
+FRESULT f_getfree_step (
+    const TCHAR* path,    /* Path name of the logical drive number */
+    FFSTEP* st,            /* Pointer to the step context */
+    UINT nsect,            /* Maximum number of sectors to be scanned in this call */
+    DWORD* nclst        /* Pointer to a variable to return number of free clusters */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    DWORD ent, stat;
+    FFOBJID obj;
+
+
+    res = find_volume(&path, &fs, 0);
+    if (res != FR_OK) LEAVE_FF(fs, res);
+    if (st->clst != 0 && (st->id != fs->id || st->fchg != fs->fat_chg)) st->clst = 0;    /* Restart the scan if the FAT has been changed since */
+    if (st->clst == 0) {                /* Start of the scan */
+        if (fs->free_clst <= fs->n_fatent - 2) {    /* If free_clst is valid, return it without FAT scan */
+            *nclst = fs->free_clst;
+#if FF_FS_RECLAIM
+            res = count_pending(fs, nclst);
+#endif
+            LEAVE_FF(fs, res);
+        }
+        st->clst = 2; st->nfree = 0;
+        st->id = fs->id; st->fchg = fs->fat_chg;
+    }
+    if (nsect == 0) nsect = 1;
+    ent = (DWORD)nsect * SS(fs) * 8 / (fs->fs_type == FS_EXFAT ? 1 : fs->fs_type == FS_FAT32 ? 32 : fs->fs_type == FS_FAT16 ? 16 : 12);    /* Number of entries in nsect sectors */
+    obj.fs = fs;
+    for ( ; ent && st->clst < fs->n_fatent; ent--, st->clst++) {
+#if FF_FS_EXFAT
+        if (fs->fs_type == FS_EXFAT) {    /* exFAT: Check the bit in the allocation bitmap */
+            stat = st->clst - 2;
+            res = move_window(fs, fs->database + stat / 8 / SS(fs));    /* Assuming bitmap starts at cluster 2 */
+            if (res != FR_OK) break;
+            if (!(fs->win[stat / 8 % SS(fs)] & (1 << (stat % 8)))) st->nfree++;
+            continue;
+        }
+#endif
+        stat = get_fat(&obj, st->clst);    /* FAT12/16/32: Check the FAT entry */
+        if (stat == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+        if (stat == 1) { res = FR_INT_ERR; break; }
+        if (stat == 0) st->nfree++;
+    }
+    if (res == FR_OK && st->clst >= fs->n_fatent) {    /* End of the scan? */
+        st->clst = 0;
+        fs->free_clst = st->nfree;        /* Now free_clst is valid */
+        fs->fsi_flag |= 1;                /* FAT32: FSInfo is to be updated */
+        *nclst = st->nfree;
+#if FF_FS_RECLAIM
+        res = count_pending(fs, nclst);
+#endif
+    }
+    if (res != FR_OK) st->clst = 0;
+    LEAVE_FF(fs, res);
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Truncate File                                                         */
 /*-----------------------------------------------------------------------*/
@@ -4572,16 +5989,31 @@ FRESULT f_truncate (
 
     if (fp->fptr < fp->obj.objsize) {    /* Process when fptr is not on the eof */
         if (fp->fptr == 0) {    /* When set file size to zero, remove entire cluster chain */
-            res = remove_chain(&fp->obj, fp->obj.sclust, 0);
+            res = release_chain(&fp->obj, fp->obj.sclust, 0, SIZE_CLST(fs, fp->obj.objsize));
             fp->obj.sclust = 0;
+#if FF_FS_CONTIG
+            fp->obj.n_lead = 0;
+#endif
+#if FF_SEEK_INDEX
+            fp->ck_n = 0;
+#endif
         } else {                /* When truncate a part of the file, remove remaining clusters */
             ncl = get_fat(&fp->obj, fp->clust);
             res = FR_OK;
             if (ncl == 0xFFFFFFFF) res = FR_DISK_ERR;
             if (ncl == 1) res = FR_INT_ERR;
             if (res == FR_OK && ncl < fs->n_fatent) {
-                res = remove_chain(&fp->obj, ncl, fp->clust);
+                res = release_chain(&fp->obj, ncl, fp->clust, SIZE_CLST(fs, fp->obj.objsize) - SIZE_CLST(fs, fp->fptr));
+            }
+#if FF_FS_CONTIG
+            if (fp->obj.n_lead > fp->clust - fp->obj.sclust + 1) {    /* Clip the contiguous part */
+                fp->obj.n_lead = fp->clust - fp->obj.sclust + 1;
             }
+#endif
+#if FF_SEEK_INDEX
+            ncl = (DWORD)((fp->fptr - 1) / SS(fs) / fs->csize) >> fp->ck_shift;    /* Discard the checkpoints on the removed clusters */
+            if (fp->ck_n > ncl) fp->ck_n = (BYTE)ncl;
+#endif
         }
         fp->obj.objsize = fp->fptr;    /* Set file size to current read/write point */
         fp->flag |= FA_MODIFIED;
@@ -4613,7 +6045,7 @@ FRESULT f_unlink (
 {
     FRESULT res;
     DIR dj, sdj;
-    DWORD dclst = 0;
+    DWORD dclst = 0, ncl = 0xFFFFFFFF;
     FATFS *fs;
 #if FF_FS_EXFAT
     FFOBJID obj;
@@ -4652,6 +6084,7 @@ FRESULT f_unlink (
 #endif
                 {
                     dclst = ld_clust(fs, dj.dir);
+                    ncl = SIZE_CLST(fs, LDDWORD(dj.dir + DIR_FileSize));    /* Number of clusters in the file (not known for a directory) */
                 }
                 if (dj.obj.attr & AM_DIR) {            /* Is it a sub-directory? */
 #if FF_FS_RPATH != 0
@@ -4681,9 +6114,9 @@ FRESULT f_unlink (
                 res = dir_remove(&dj);            /* Remove the directory entry */
                 if (res == FR_OK && dclst) {    /* Remove the cluster chain if exist */
 #if FF_FS_EXFAT
-                    res = remove_chain(&obj, dclst, 0);
+                    res = release_chain(&obj, dclst, 0, ncl);
 #else
-                    res = remove_chain(&dj.obj, dclst, 0);
+                    res = release_chain(&dj.obj, dclst, 0, ncl);
 #endif
                 }
                 if (res == FR_OK) res = sync_fs(fs);
@@ -4895,7 +6328,7 @@ FRESULT f_rename (
 
 
 
-#if FF_USE_CHMOD && !FF_FS_READONLY
+#if (FF_USE_CHMOD || FF_USE_COPY) && !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* Change Attribute                                                      */
 /*-----------------------------------------------------------------------*/
@@ -4947,9 +6380,10 @@ FRESULT f_chmod (
 /* Change Timestamp                                                      */
 /*-----------------------------------------------------------------------*/
 
-FRESULT f_utime (
+static
+FRESULT set_mtime (
     const TCHAR* path,    /* Pointer to the file/directory name */
-    const FILINFO* fno    /* Pointer to the timestamp to be set */
+    DWORD tm            /* Timestamp to be set (date in upper 16 bits, time in lower 16 bits) */
 )
 {
     FRESULT res;
@@ -4967,12 +6401,12 @@ FRESULT f_utime (
         if (res == FR_OK) {
 #if FF_FS_EXFAT
             if (fs->fs_type == FS_EXFAT) {
-                STDWORD(fs->dirbuf + XDIR_ModTime, (DWORD)fno->fdate << 16 | fno->ftime);
+                STDWORD(fs->dirbuf + XDIR_ModTime, tm);
                 res = store_xdir(&dj);
             } else
 #endif
             {
-                STDWORD(dj.dir + DIR_ModTime, (DWORD)fno->fdate << 16 | fno->ftime);
+                STDWORD(dj.dir + DIR_ModTime, tm);
                 fs->wflag = 1;
             }
             if (res == FR_OK) {
@@ -4985,7 +6419,16 @@ FRESULT f_utime (
     LEAVE_FF(fs, res);
 }
 
-#endif    /* FF_USE_CHMOD && !FF_FS_READONLY */
+
+FRESULT f_utime (
+    const TCHAR* path,    /* Pointer to the file/directory name */
+    const FILINFO* fno    /* Pointer to the timestamp to be set */
+)
+{
+    return set_mtime(path, (DWORD)fno->fdate << 16 | fno->ftime);
+}
+
+#endif    /* (FF_USE_CHMOD || FF_USE_COPY) && !FF_FS_READONLY */
 
 
 
@@ -5232,48 +6675,58 @@ FRESULT f_expand (
 #endif
     n = (DWORD)fs->csize * SS(fs);    /* Cluster size */
     tcl = (DWORD)(fsz / n) + ((fsz & (n - 1)) ? 1 : 0);    /* Number of clusters required */
-    stcl = fs->last_clst; lclst = 0;
-    if (stcl < 2 || stcl >= fs->n_fatent) stcl = 2;
+    for (;;) {
+        stcl = fs->last_clst;
+        if (stcl < 2 || stcl >= fs->n_fatent) stcl = 2;
+#if FF_FS_EXFAT
+        if (fs->fs_type == FS_EXFAT) {
+            scl = find_bitmap(fs, stcl, tcl);            /* Find a contiguous cluster block */
+            if (scl == 0) res = FR_DENIED;                /* No contiguous cluster block was found */
+            if (scl == 0xFFFFFFFF) res = FR_DISK_ERR;
+        } else
+#endif
+        {
+            scl = clst = stcl; ncl = 0;
+            for (;;) {    /* Find a contiguous cluster block */
+                n = get_fat(&fp->obj, clst);
+                if (++clst >= fs->n_fatent) clst = 2;
+                if (n == 1) { res = FR_INT_ERR; break; }
+                if (n == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+                if (n == 0) {    /* Is it a free cluster? */
+                    if (++ncl == tcl) break;    /* Break if a contiguous cluster block is found */
+                } else {
+                    scl = clst; ncl = 0;        /* Not a free cluster */
+                }
+                if (clst == stcl) { res = FR_DENIED; break; }    /* No contiguous cluster? */
+            }
+        }
+#if FF_FS_RECLAIM
+        if (res == FR_DENIED && fs->rcl_clst[0] != 0) {    /* Free the chains pending to be removed and retry */
+            res = reclaim_chain(fs, 0xFFFFFFFF);
+            if (res == FR_OK) continue;
+        }
+#endif
+        break;
+    }
 
+    lclst = 0;
+    if (res == FR_OK) {    /* A contiguous free area is found */
+        if (opt) {        /* Allocate it now */
 #if FF_FS_EXFAT
-    if (fs->fs_type == FS_EXFAT) {
-        scl = find_bitmap(fs, stcl, tcl);            /* Find a contiguous cluster block */
-        if (scl == 0) res = FR_DENIED;                /* No contiguous cluster block was found */
-        if (scl == 0xFFFFFFFF) res = FR_DISK_ERR;
-        if (res == FR_OK) {    /* A contiguous free area is found */
-            if (opt) {        /* Allocate it now */
+            if (fs->fs_type == FS_EXFAT) {
                 res = change_bitmap(fs, scl, tcl, 1);    /* Mark the cluster block 'in use' */
                 lclst = scl + tcl - 1;
-            } else {        /* Set it as suggested point for next allocation */
-                lclst = scl - 1;
-            }
-        }
-    } else
+            } else
 #endif
-    {
-        scl = clst = stcl; ncl = 0;
-        for (;;) {    /* Find a contiguous cluster block */
-            n = get_fat(&fp->obj, clst);
-            if (++clst >= fs->n_fatent) clst = 2;
-            if (n == 1) { res = FR_INT_ERR; break; }
-            if (n == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
-            if (n == 0) {    /* Is it a free cluster? */
-                if (++ncl == tcl) break;    /* Break if a contiguous cluster block is found */
-            } else {
-                scl = clst; ncl = 0;        /* Not a free cluster */
-            }
-            if (clst == stcl) { res = FR_DENIED; break; }    /* No contiguous cluster? */
-        }
-        if (res == FR_OK) {    /* A contiguous free area is found */
-            if (opt) {        /* Allocate it now */
+            {
                 for (clst = scl, n = tcl; n; clst++, n--) {    /* Create a cluster chain on the FAT */
                     res = put_fat(fs, clst, (n == 1) ? 0xFFFFFFFF : clst + 1);
                     if (res != FR_OK) break;
                     lclst = clst;
                 }
-            } else {        /* Set it as suggested point for next allocation */
-                lclst = scl - 1;
             }
+        } else {        /* Set it as suggested point for next allocation */
+            lclst = scl - 1;
         }
     }
 
@@ -5282,6 +6735,9 @@ FRESULT f_expand (
         if (opt) {    /* Is it allocated now? */
             fp->obj.sclust = scl;        /* Update object allocation information */
             fp->obj.objsize = fsz;
+#if FF_FS_CONTIG
+            fp->obj.n_lead = tcl;        /* Whole chain is contiguous */
+#endif
             if (FF_FS_EXFAT) fp->obj.stat = 2;    /* Set status 'contiguous chain' */
             fp->flag |= FA_MODIFIED;
             if (fs->free_clst <= fs->n_fatent - 2) {    /* Update FSINFO */
@@ -5302,20 +6758,33 @@ FRESULT f_expand (
 /*-----------------------------------------------------------------------*/
 /* Forward Data to the Stream Directly                                   */
 /*-----------------------------------------------------------------------*/
+/* When a bounce buffer is given, runs of whole sectors are read into it */
+/* with a multi-sector read and forwarded in a chunk. At FF_USE_ASYNC,   */
+/* the buffer is split in two and the next run is read into the other   */
+/* half while the stream function is taking the current run.            */
 
-FRESULT f_forward (
+static
+FRESULT forward_data (
     FIL* fp,                         /* Pointer to the file object */
     UINT (*func)(const BYTE*,UINT),    /* Pointer to the streaming function */
     UINT btf,                        /* Number of bytes to forward */
-    UINT* bf                        /* Pointer to number of bytes forwarded */
+    UINT* bf,                        /* Pointer to number of bytes forwarded */
+    BYTE* buff,                        /* Pointer to the bounce buffer (null:not used) */
+    UINT bsize                        /* Size of the bounce buffer in byte */
 )
 {
     FRESULT res;
     FATFS *fs;
     DWORD clst, sect;
     FSIZE_t remain;
-    UINT rcnt, csect;
+    UINT rcnt, csect, cc, nbs;
     BYTE *dbuf;
+#if FF_USE_ASYNC
+    DWORD psect = 0;    /* Start sector of the run being read ahead */
+    UINT pcnt = 0;        /* Number of sectors being read ahead (0:none) */
+    BYTE *pbuf = 0;        /* Half of the bounce buffer the run is read into */
+    int st;
+#endif
 
 
     *bf = 0;    /* Clear transfer byte counter */
@@ -5325,50 +6794,514 @@ FRESULT f_forward (
 
     remain = fp->obj.objsize - fp->fptr;
     if (btf > remain) btf = (UINT)remain;            /* Truncate btf by remaining bytes */
+    nbs = buff ? bsize / SS(fs) : 0;                /* Number of sectors in the bounce buffer */
+#if FF_USE_ASYNC
+    nbs /= 2;                                        /* Use it as two halves */
+#endif
 
+    rcnt = 1;
     for ( ;  btf && (*func)(0, 0);                    /* Repeat until all data transferred or stream goes busy */
         fp->fptr += rcnt, *bf += rcnt, btf -= rcnt) {
+#if FF_USE_ASYNC
+        st = 0;
+        while (pcnt && (st = disk_poll(fs->pdrv)) > 0) ;    /* Wait for end of the read ahead */
+        if (pcnt) fs->as_obj = 0;                /* The drive is free */
+        if (st < 0) ABORT(fs, FR_DISK_ERR);
+#endif
         csect = (UINT)(fp->fptr / SS(fs) & (fs->csize - 1));    /* Sector offset in the cluster */
         if (fp->fptr % SS(fs) == 0) {                /* On the sector boundary? */
             if (csect == 0) {                        /* On the cluster boundary? */
                 clst = (fp->fptr == 0) ?            /* On the top of the file? */
-                    fp->obj.sclust : get_fat(&fp->obj, fp->clust);
+                    fp->obj.sclust : next_clust(&fp->obj, fp->clust, 0);
                 if (clst <= 1) ABORT(fs, FR_INT_ERR);
                 if (clst == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
                 fp->clust = clst;                    /* Update current cluster */
+#if FF_SEEK_INDEX
+                put_ckpt(fp, clst);
+#endif
             }
         }
         sect = clst2sect(fs, fp->clust);            /* Get current data sector */
         if (sect == 0) ABORT(fs, FR_INT_ERR);
         sect += csect;
+        cc = btf / SS(fs);
+        if (nbs && fp->fptr % SS(fs) == 0 && cc > 0) {    /* Forward a run of whole sectors via the bounce buffer */
+            if (cc > nbs) cc = nbs;
+            if (csect + cc > fs->csize) cc = fs->csize - csect;    /* Clip at cluster boundary */
+#if FF_USE_ASYNC
+            if (pcnt && psect == sect) {        /* Has the run been read ahead? */
+                dbuf = pbuf; cc = pcnt;
+            } else {
+                dbuf = (pbuf == buff) ? buff + nbs * SS(fs) : buff;
+                res = xfer_data(&fp->obj, dbuf, sect, cc, 0);
+                if (res != FR_OK) ABORT(fs, res);
+            }
+            pcnt = 0;
+#else
+            dbuf = buff;
+            res = xfer_data(&fp->obj, dbuf, sect, cc, 0);
+            if (res != FR_OK) ABORT(fs, res);
+#endif
+#if !FF_FS_READONLY && FF_FS_MINIMIZE <= 2        /* Replace one of the read sectors with cached data if it contains a dirty sector */
+#if FF_FS_TINY
+            if (fs->wflag && fs->winsect - sect < cc) {
+                MEMCPY(dbuf + ((fs->winsect - sect) * SS(fs)), fs->win, SS(fs));
+            }
+#else
+            if ((fp->flag & FA_DIRTY) && fp->sect - sect < cc) {
+                MEMCPY(dbuf + ((fp->sect - sect) * SS(fs)), fp->buf, SS(fs));
+            }
+#endif
+#endif
+#if FF_USE_ASYNC
+            rcnt = btf / SS(fs) - cc;                /* Number of whole sectors left after this run */
+            if (rcnt > 0) {                            /* Start to read the next run into the other half */
+                psect = sect + cc;
+                csect += cc;
+                if (csect >= fs->csize) {            /* Next run is in the next cluster */
+                    csect = 0;
+                    clst = next_clust(&fp->obj, fp->clust, 0);
+                    psect = (clst >= 2 && clst != 0xFFFFFFFF) ? clst2sect(fs, clst) : 0;
+                }
+                if (rcnt > nbs) rcnt = nbs;
+                if (csect + rcnt > fs->csize) rcnt = fs->csize - csect;
+                pbuf = (dbuf == buff) ? buff + nbs * SS(fs) : buff;
+                if (psect != 0 && !async_owner(fs) && disk_submit(fs->pdrv, pbuf, psect, rcnt, 0) == 0) {
+                    pcnt = rcnt;
+                    fs->as_obj = fp;                /* The drive is in use by this file */
+                }
+            }
+#endif
+            rcnt = (*func)(dbuf, cc * SS(fs));        /* Forward the run */
+        } else {
+#if FF_USE_ASYNC
+            pcnt = 0;                                /* Discard the read ahead */
+#endif
 #if FF_FS_TINY
-        if (move_window(fs, sect) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Move sector window to the file data */
-        dbuf = fs->win;
+            if (move_window(fs, sect) != FR_OK) ABORT(fs, FR_DISK_ERR);    /* Move sector window to the file data */
+            dbuf = fs->win;
 #else
-        if (fp->sect != sect) {        /* Fill sector cache with file data */
+            if (fp->sect != sect) {        /* Fill sector cache with file data */
 #if !FF_FS_READONLY
-            if (fp->flag & FA_DIRTY) {        /* Write-back dirty sector cache */
-                if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) ABORT(fs, FR_DISK_ERR);
-                fp->flag &= (BYTE)~FA_DIRTY;
+                if (fp->flag & FA_DIRTY) {        /* Write-back dirty sector cache */
+                    res = xfer_data(&fp->obj, fp->buf, fp->sect, 1, 1);
+                    if (res != FR_OK) ABORT(fs, res);
+                    fp->flag &= (BYTE)~FA_DIRTY;
+                }
+#endif
+                res = xfer_data(&fp->obj, fp->buf, sect, 1, 0);
+                if (res != FR_OK) ABORT(fs, res);
             }
+            dbuf = fp->buf;
 #endif
-            if (disk_read(fs->pdrv, fp->buf, sect, 1) != RES_OK) ABORT(fs, FR_DISK_ERR);
+            fp->sect = sect;
+            rcnt = SS(fs) - (UINT)fp->fptr % SS(fs);    /* Number of bytes left in the sector */
+            if (rcnt > btf) rcnt = btf;                    /* Clip it by btr if needed */
+            rcnt = (*func)(dbuf + ((UINT)fp->fptr % SS(fs)), rcnt);    /* Forward the file data */
         }
-        dbuf = fp->buf;
-#endif
-        fp->sect = sect;
-        rcnt = SS(fs) - (UINT)fp->fptr % SS(fs);    /* Number of bytes left in the sector */
-        if (rcnt > btf) rcnt = btf;                    /* Clip it by btr if needed */
-        rcnt = (*func)(dbuf + ((UINT)fp->fptr % SS(fs)), rcnt);    /* Forward the file data */
-        if (rcnt == 0) ABORT(fs, FR_INT_ERR);
+        if (rcnt == 0) break;
     }
+#if FF_USE_ASYNC
+    while (pcnt && (st = disk_poll(fs->pdrv)) > 0) ;    /* Wait for end of the read ahead */
+    if (pcnt) fs->as_obj = 0;
+#endif
+    if (btf && rcnt == 0) ABORT(fs, FR_INT_ERR);    /* Stream function took no data */
 
     LEAVE_FF(fs, FR_OK);
 }
+
+
+FRESULT f_forward (
+    FIL* fp,                         /* Pointer to the file object */
+    UINT (*func)(const BYTE*,UINT),    /* Pointer to the streaming function */
+    UINT btf,                        /* Number of bytes to forward */
+    UINT* bf                        /* Pointer to number of bytes forwarded */
+)
+{
+    return forward_data(fp, func, btf, bf, 0, 0);
+}
+
+
+FRESULT f_forward_buf (
+    FIL* fp,                         /* Pointer to the file object */
+    UINT (*func)(const BYTE*,UINT),    /* Pointer to the streaming function */
+    UINT btf,                        /* Number of bytes to forward */
+    UINT* bf,                        /* Pointer to number of bytes forwarded */
+    BYTE* buff,                        /* Pointer to the bounce buffer */
+    UINT bsize                        /* Size of the bounce buffer in byte */
+)
+{
+    return forward_data(fp, func, btf, bf, buff, bsize);
+}
 #endif /* FF_USE_FORWARD */
 
 
 
+
+#if FF_USE_LOAD
+/*-----------------------------------------------------------------------*/
+/* Load a File into Memory                                               */
+/*-----------------------------------------------------------------------*/
+/* The file is loaded without a file object. Each run of contiguous      */
+/* clusters is read into the destination with a multi-sector read and   */
+/* only a partial last sector is copied via the window.                  */
+
+FRESULT f_load (
+    const TCHAR* path,    /* Pointer to the file name */
+    void* dst,            /* Pointer to the memory to load the file into */
+    UINT maxlen,        /* Size of the memory in byte */
+    UINT* len            /* Pointer to number of bytes loaded */
+)
+{
+    FRESULT res;
+    DIR dj;
+    FATFS *fs;
+    DWORD cl, tcl, ncl, need, bcs, sect;
+    UINT btl, cc;
+    BYTE *rbuff = (BYTE*)dst;
+    DEF_NAMBUF
+
+
+    *len = 0;
+    res = find_volume(&path, &fs, 0);
+    if (res == FR_OK) {
+        dj.obj.fs = fs;
+        INIT_NAMBUF(fs);
+        res = follow_path(&dj, path);    /* Follow the file path */
+        if (res == FR_OK) {
+            if (dj.fn[NSFLAG] & NS_NONAME) {    /* Is it origin directory itself? */
+                res = FR_INVALID_NAME;
+            } else {
+                if (dj.obj.attr & AM_DIR) {        /* Is it a directory? */
+                    res = FR_NO_FILE;
+                }
+#if !FF_FS_READONLY && FF_FS_LOCK != 0
+                else {
+                    res = chk_lock(&dj, 0);        /* Check if the file can be read */
+                }
+#endif
+            }
+        }
+        if (res == FR_OK) {    /* Get object allocation info into the directory object */
+#if FF_FS_EXFAT
+            if (fs->fs_type == FS_EXFAT) {
+                dj.obj.sclust = LDDWORD(fs->dirbuf + XDIR_FstClus);
+                dj.obj.objsize = LDQWORD(fs->dirbuf + XDIR_FileSize);
+                dj.obj.stat = fs->dirbuf[XDIR_GenFlags] & 2;
+                dj.obj.n_frag = 0;
+            } else
+#endif
+            {
+                dj.obj.sclust = ld_clust(fs, dj.dir);
+                dj.obj.objsize = LDDWORD(dj.dir + DIR_FileSize);
+            }
+#if FF_FS_CONTIG
+            dj.obj.n_lead = dj.obj.sclust ? 1 : 0;
+#endif
+            dj.obj.id = fs->id;            /* Validate the object for xfer_data() */
+#if FF_FS_REENTRANT == 2
+            dj.obj.xfer = 0;
+#endif
+
+            btl = (dj.obj.objsize < maxlen) ? (UINT)dj.obj.objsize : maxlen;    /* Number of bytes to load */
+            bcs = (DWORD)fs->csize * SS(fs);    /* Cluster size in byte */
+            cl = dj.obj.sclust;
+            while (res == FR_OK && btl > 0) {
+                /* Get a run of contiguous clusters as long as needed */
+                need = (btl - 1) / bcs + 1;
+                tcl = cl; ncl = 1;
+                while (ncl < need) {
+                    cl = next_clust(&dj.obj, tcl + ncl - 1, 0);
+                    if (cl <= 1) { res = FR_INT_ERR; break; }
+                    if (cl == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+                    if (cl != tcl + ncl) break;
+                    ncl++;
+                }
+                if (res != FR_OK) break;
+                sect = clst2sect(fs, tcl);
+                if (sect == 0) { res = FR_INT_ERR; break; }
+                cc = btl / SS(fs);        /* Number of whole sectors to load from the run */
+                if (cc > ncl * fs->csize) cc = ncl * fs->csize;
+                if (cc > 0) {
+                    res = xfer_data(&dj.obj, rbuff, sect, cc, 0);
+                    if (res != FR_OK) break;
+#if !FF_FS_READONLY && FF_FS_TINY    /* Replace one of the read sectors with cached data if it contains a dirty sector */
+                    if (fs->wflag && fs->winsect - sect < cc) {
+                        MEMCPY(rbuff + ((fs->winsect - sect) * SS(fs)), fs->win, SS(fs));
+                    }
+#endif
+                    rbuff += cc * SS(fs); btl -= cc * SS(fs); *len += cc * SS(fs);
+                }
+                if (btl > 0 && cc < ncl * fs->csize) {    /* Partial last sector in the run? */
+                    res = move_window(fs, sect + cc);
+                    if (res != FR_OK) break;
+                    MEMCPY(rbuff, fs->win, btl);
+                    *len += btl; btl = 0;
+                }
+            }
+        }
+        FREE_NAMBUF();
+    }
+#if FF_FS_REENTRANT == 2
+    if (res == FR_TIMEOUT && dj.obj.xfer && validate(&dj.obj, &fs) == FR_OK) {    /* Settle the transfer count left by the grant timeout */
+        unlock_fs(fs, FR_OK);
+    }
+#endif
+
+    LEAVE_FF(fs, res);
+}
+
+#endif /* FF_USE_LOAD */
+
+
+
+
+#if FF_USE_COPY && !FF_FS_READONLY && FF_FS_MINIMIZE == 0
+/*-----------------------------------------------------------------------*/
+/* Copy a File                                                           */
+/*-----------------------------------------------------------------------*/
+/* The destination is allocated in a contiguous block if possible and    */
+/* the data is moved in multi-sector transfers up to the size of the     */
+/* work buffer. The timestamp and attributes are copied along. The       */
+/* source is read with a directory object as f_load() does, so that only */
+/* the destination needs a file object on the stack.                     */
+
+static
+FRESULT copy_open (    /* Open the source file into a directory object */
+    DIR* dp,            /* Pointer to the directory object to return the source file */
+    const TCHAR* path,    /* Pointer to the source file name */
+    DWORD* tm,            /* Pointer to return the timestamp of the source file */
+    BYTE* attr            /* Pointer to return the attribute of the source file */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    DEF_NAMBUF
+
+
+    res = find_volume(&path, &fs, 0);
+    if (res == FR_OK) {
+        dp->obj.fs = fs;
+        INIT_NAMBUF(fs);
+        res = follow_path(dp, path);    /* Follow the file path */
+        if (res == FR_OK) {
+            if (dp->fn[NSFLAG] & NS_NONAME) {    /* Is it origin directory itself? */
+                res = FR_INVALID_NAME;
+            } else {
+                if (dp->obj.attr & AM_DIR) {    /* Is it a directory? */
+                    res = FR_NO_FILE;
+                }
+#if FF_FS_LOCK != 0
+                else {
+                    res = chk_lock(dp, 0);        /* Check if the file can be read */
+                    if (res == FR_OK) {
+                        dp->obj.lockid = inc_lock(dp, 0);    /* Lock the file until f_closedir() */
+                        if (!dp->obj.lockid) res = FR_INT_ERR;
+                    }
+                }
+#endif
+            }
+        }
+        if (res == FR_OK) {    /* Get object allocation info and timestamp into the directory object */
+#if FF_FS_EXFAT
+            if (fs->fs_type == FS_EXFAT) {
+                dp->obj.sclust = LDDWORD(fs->dirbuf + XDIR_FstClus);
+                dp->obj.objsize = LDQWORD(fs->dirbuf + XDIR_FileSize);
+                dp->obj.stat = fs->dirbuf[XDIR_GenFlags] & 2;
+                dp->obj.n_frag = 0;
+                *tm = LDDWORD(fs->dirbuf + XDIR_ModTime);
+                *attr = fs->dirbuf[XDIR_Attr];
+            } else
+#endif
+            {
+                dp->obj.sclust = ld_clust(fs, dp->dir);
+                dp->obj.objsize = LDDWORD(dp->dir + DIR_FileSize);
+                *tm = LDDWORD(dp->dir + DIR_ModTime);
+                *attr = dp->dir[DIR_Attr];
+            }
+#if FF_FS_CONTIG
+            dp->obj.n_lead = dp->obj.sclust ? 1 : 0;
+#endif
+            dp->obj.id = fs->id;            /* Validate the object */
+#if FF_FS_REENTRANT == 2
+            dp->obj.xfer = 0;
+#endif
+        }
+        FREE_NAMBUF();
+    }
+
+    LEAVE_FF(fs, res);
+}
+
+
+static
+FRESULT copy_get (    /* Read a run of contiguous sectors of the source file */
+    DIR* dp,        /* Pointer to the source file opened by copy_open() (clust is the current cluster) */
+    FSIZE_t* fptr,    /* Pointer to the read offset in the file (on a sector boundary) */
+    BYTE* buff,        /* Pointer to the work buffer */
+    UINT nsect,        /* Size of the work buffer in unit of sector */
+    UINT* br        /* Pointer to number of bytes read */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    DWORD clst, sect = 0;
+    FSIZE_t remain;
+    UINT csect, cc, n;
+
+
+    *br = 0;
+    res = validate(&dp->obj, &fs);        /* Check validity of the source object */
+    if (res != FR_OK) LEAVE_FF(fs, res);
+
+    remain = dp->obj.objsize - *fptr;
+    if (remain < (FSIZE_t)nsect * SS(fs)) nsect = (UINT)((remain + SS(fs) - 1) / SS(fs));    /* Clip at end of the file */
+    for (cc = 0; cc < nsect; cc += n) {        /* Get a run of contiguous sectors */
+        csect = (UINT)(*fptr / SS(fs) & (fs->csize - 1));    /* Sector offset in the cluster */
+        if (csect == 0) {                    /* On the cluster boundary? */
+            clst = (*fptr == 0) ?            /* On the top of the file? */
+                dp->obj.sclust : next_clust(&dp->obj, dp->clust, 0);
+            if (clst <= 1) LEAVE_FF(fs, FR_INT_ERR);
+            if (clst == 0xFFFFFFFF) LEAVE_FF(fs, FR_DISK_ERR);
+            if (cc > 0 && clst != dp->clust + 1) break;    /* End of the run */
+            dp->clust = clst;                /* Update current cluster */
+        }
+        if (cc == 0) {
+            sect = clst2sect(fs, dp->clust);
+            if (sect == 0) LEAVE_FF(fs, FR_INT_ERR);
+            sect += csect;
+        }
+        n = fs->csize - csect;
+        if (n > nsect - cc) n = nsect - cc;
+        *fptr += (FSIZE_t)n * SS(fs);
+    }
+    if (cc > 0) {
+        res = xfer_data(&dp->obj, buff, sect, cc, 0);
+        if (res != FR_OK) LEAVE_FF(fs, res);
+#if FF_FS_TINY        /* Replace one of the read sectors with cached data if it contains a dirty sector */
+        if (fs->wflag && fs->winsect - sect < cc) {
+            MEMCPY(buff + ((fs->winsect - sect) * SS(fs)), fs->win, SS(fs));
+        }
+#endif
+        *br = (remain < (FSIZE_t)cc * SS(fs)) ? (UINT)remain : cc * SS(fs);
+        if (*fptr > dp->obj.objsize) *fptr = dp->obj.objsize;
+    }
+
+    LEAVE_FF(fs, FR_OK);
+}
+
+
+#if FF_USE_EXPAND
+static
+FRESULT copy_put (    /* Write data into the contiguous block of the destination file */
+    FIL* fp,        /* Pointer to the destination file object (fptr is on a sector boundary) */
+    const BYTE* buff,    /* Pointer to the data to be written */
+    UINT btw        /* Number of bytes to write */
+)
+{
+    FRESULT res;
+    FATFS *fs;
+    DWORD sect;
+    UINT cc;
+
+
+    res = validate(&fp->obj, &fs);        /* Check validity of the file object */
+    if (res != FR_OK || (res = (FRESULT)fp->err) != FR_OK) LEAVE_FF(fs, res);
+
+    sect = clst2sect(fs, fp->obj.sclust);    /* Top of the block */
+    if (sect == 0) ABORT(fs, FR_INT_ERR);
+    sect += (DWORD)(fp->fptr / SS(fs));
+    cc = (btw + SS(fs) - 1) / SS(fs);        /* Number of sectors to write */
+    res = xfer_data(&fp->obj, (BYTE*)buff, sect, cc, 1);
+    if (res != FR_OK) ABORT(fs, res);
+#if FF_FS_TINY
+    if (fs->winsect - sect < cc) {    /* Refill sector cache if it gets invalidated by the direct write */
+        MEMCPY(fs->win, buff + ((fs->winsect - sect) * SS(fs)), SS(fs));
+        fs->wflag = 0;
+    }
+#endif
+    fp->fptr += btw;
+    fp->clust = fp->obj.sclust + (DWORD)((fp->fptr - 1) / SS(fs) / fs->csize);    /* Current cluster */
+
+    LEAVE_FF(fs, FR_OK);
+}
+#endif
+
+
+FRESULT f_copy (
+    const TCHAR* path_src,    /* Pointer to the source file name */
+    const TCHAR* path_dst,    /* Pointer to the destination file name */
+    void* work,            /* Pointer to the work buffer */
+    UINT len            /* Size of the work buffer in byte */
+)
+{
+    FRESULT res, res2;
+    DIR dsrc;
+    FIL fdst;
+    FSIZE_t fptr = 0;
+    DWORD tm;
+    UINT nsect, br, bw;
+    BYTE attr;
+#if FF_USE_EXPAND
+    int contig = 0;
+#endif
+
+
+    res = copy_open(&dsrc, path_src, &tm, &attr);    /* Open the source and get its timestamp and attributes */
+    if (res != FR_OK) return res;
+    nsect = len / SS(dsrc.obj.fs);        /* Size of the work buffer in unit of sector */
+    if (nsect == 0) {
+        f_closedir(&dsrc);
+        return FR_NOT_ENOUGH_CORE;
+    }
+
+    res = f_open(&fdst, path_dst, FA_WRITE | FA_OPEN_ALWAYS);
+    if (res == FR_OK) {
+        if (fdst.obj.fs == dsrc.obj.fs && fdst.dir_sect == dsrc.sect && fdst.dir_ptr == dsrc.dir) {
+            res = FR_DENIED;    /* Source and destination are the same file */
+            f_close(&fdst);
+            f_closedir(&dsrc);
+            return res;
+        }
+        res = f_truncate(&fdst);        /* Discard current contents of the destination */
+#if FF_USE_EXPAND
+        if (res == FR_OK && dsrc.obj.objsize > 0 && SS(fdst.obj.fs) == SS(dsrc.obj.fs)) {
+            res = f_expand(&fdst, dsrc.obj.objsize, 1);    /* Allocate a contiguous block */
+            if (res == FR_OK) contig = 1;
+            if (res == FR_DENIED) res = FR_OK;    /* No contiguous block, allocate clusters as written */
+        }
+#endif
+        while (res == FR_OK) {        /* Move the data */
+            res = copy_get(&dsrc, &fptr, (BYTE*)work, nsect, &br);
+            if (res != FR_OK || br == 0) break;
+#if FF_USE_EXPAND
+            if (contig) {
+                res = copy_put(&fdst, (const BYTE*)work, br);
+            } else
+#endif
+            {
+                res = f_write(&fdst, work, br, &bw);
+                if (res == FR_OK && bw < br) res = FR_DENIED;    /* Disk full */
+            }
+        }
+        res2 = f_close(&fdst);
+        if (res == FR_OK) res = res2;
+        if (res == FR_OK) {                /* The data has been copied */
+            res = set_mtime(path_dst, tm);    /* Copy the timestamp */
+            if (res == FR_OK) res = f_chmod(path_dst, attr, AM_RDO | AM_HID | AM_SYS | AM_ARC);    /* Copy the attributes */
+        } else {
+            f_unlink(path_dst);            /* Remove the incomplete copy */
+        }
+    }
+    f_closedir(&dsrc);
+
+    return res;
+}
+
+#endif /* FF_USE_COPY && !FF_FS_READONLY && FF_FS_MINIMIZE == 0 */
+
+
+
 #if FF_USE_MKFS && !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* Create an FAT/exFAT volume                                            */
@@ -43,7 +43,15 @@
 
 
 #define FF_USE_FASTSEEK     0
-/* This option switches fast seek function. (0:Disable or 1:Enable) */
+/* This option switches fast seek function and f_getextents() function. (0:Disable or 1:Enable) */
+
+
+#define FF_SEEK_INDEX       0
+/* This option sets number of seek checkpoints held in each file object. (0:Disable
+/  or 2-255) The cluster# is recorded at every 2^n clusters as the file is accessed,
+/  and f_lseek() follows the cluster chain from the nearest checkpoint. The interval
+/  is set from the file size on open and doubled when the file grows over the table.
+/  Each checkpoint takes 4 bytes in the FIL structure. */
 
 
 #define FF_USE_EXPAND       0
@@ -61,7 +69,45 @@
 
 
 #define FF_USE_FORWARD      0
-/* This option switches f_forward() function. (0:Disable or 1:Enable) */
+/* This option switches f_forward() and f_forward_buf() function. (0:Disable or 1:Enable)
+/  f_forward_buf() reads runs of whole sectors into a caller supplied bounce buffer
+/  and forwards them in multi-sector chunks. When FF_USE_ASYNC is also enabled, the
+/  buffer is used as a ping-pong pair and the next run is read during the callback. */
+
+
+#define FF_USE_ASYNC        0
+/* This option switches f_read_async(), f_write_async() and f_async_poll() functions.
+/  (0:Disable or 1:Enable) To enable them, the disk driver needs to provide
+/  disk_submit() and disk_poll() functions to start a sector transfer and check its
+/  completion. Only one transfer is kept in flight on each drive. Other accesses to
+/  the drive wait for its end with disk_poll(), and the transfers of other files
+/  started meanwhile are done synchronously. The file object must not be used by
+/  other functions until f_async_busy() gets 0. */
+
+
+#define FF_USE_LOAD         0
+/* This option switches f_load() function. (0:Disable or 1:Enable)
+/  f_load() loads a whole file into memory without a file object, reading each run
+/  of contiguous clusters with a single multi-sector read into the destination. */
+
+
+#define FF_USE_COPY         0
+/* This option switches f_copy() function. (0:Disable or 1:Enable)
+/  f_copy() copies a file within a volume or across volumes, moving the data in
+/  multi-sector transfers up to the size of the given work buffer. At FF_USE_EXPAND,
+/  the destination is allocated in a contiguous block if possible. The timestamp and
+/  attributes are copied with f_utime() and f_chmod(), which are enabled by this option.
+/  The source is read without a file object, so f_copy() takes a FIL (including its
+/  FF_MAX_SS bytes sector buffer at FF_FS_TINY == 0) and a DIR on the stack.
+/  Also FF_FS_READONLY needs to be 0 and FF_FS_MINIMIZE needs to be 0 to enable this option. */
+
+
+#define FF_USE_DATASYNC     0
+/* This option switches f_datasync() function. (0:Disable or 1:Enable)
+/  f_datasync() flushes the file data like f_sync() but skips the directory entry
+/  update while the file size and allocation are unchanged. Each file object gets
+/  larger to hold the allocation recorded in the directory entry. Also FF_FS_READONLY
+/  needs to be 0 to enable this option. */
 
 
 /*---------------------------------------------------------------------------/
@@ -198,6 +244,53 @@
 */
 
 
+#define FF_FS_CONTIG        0
+/* To enable the known-contiguous fast path for FAT12/16/32 files, set FF_FS_CONTIG
+/  to 1. When enabled, each file object tracks the number of clusters known to be
+/  contiguous from top of the file, so that f_read(), f_write(), f_lseek() and
+/  f_load() get those clusters without FAT access. The files preallocated by
+/  f_expand() are known to be contiguous as a whole. Each file object gets 4 bytes
+/  larger. */
+
+
+#define FF_CHAIN_RUNS       1
+/* This option sets number of cluster runs remove_chain() collects from a chain before
+/  freeing them grouped by the FAT sector. (1-64) 1 frees each run as it is found, as
+/  the chain is followed. A larger value opts in to the batching, which saves FAT sector
+/  writes when a fragmented chain jumps between distant FAT regions, at a cost of 8 bytes
+/  of stack per run in f_unlink(), f_truncate() and the other functions removing a chain.
+/  The window may come back to a FAT sector once per batch, so such chains take some
+/  more FAT sector reads. */
+
+
+#define FF_FS_RECLAIM       0
+/* This option sets number of cluster chains that can be pending to be removed on
+/  each volume. (0:Disable or 1-16) When enabled, f_unlink(), f_truncate() and f_open()
+/  with FA_CREATE_ALWAYS remove the directory entry or truncate the chain immediately
+/  but the clusters are freed later in slices by f_reclaim_step() and f_sync(). The
+/  pending clusters are counted as free by f_getfree() and they are freed at once when
+/  the volume gets full or f_expand() finds no contiguous block. The chains pending at
+/  unmount or power loss are left as lost clusters which can be recovered by a disk
+/  check. exFAT volume is not affected. */
+
+
+#define FF_APPEND_CACHE     0
+/* This option sets number of chain ends held in the append cache on each volume.
+/  (0:Disable or 1-16) f_sync() and f_close() register the last cluster of the file
+/  and f_open() with FA_OPEN_APPEND gets it from the cache instead of following the
+/  cluster chain. Any removal of a cluster chain clears the cache. The number of hits
+/  and misses is counted in the ac_hit and ac_miss members of the FATFS structure. */
+
+
+#define FF_FS_STCACHE       0
+/* This option sets the number of validations of an open object served from the cached
+/  drive status. (0:Disable or 1-65535) When enabled, disk_status() is called once per
+/  FF_FS_STCACHE calls to the file/directory functions instead of on every call. The
+/  cache is invalidated by a disk error on a file and by f_media_changed(), which the
+/  disk driver calls on media change to dismount the volumes on the drive. At
+/  FF_FS_REENTRANT, it locks each volume and needs to be called from a task. */
+
+
 
 /*---------------------------------------------------------------------------/
 / System Configurations
@@ -264,11 +357,21 @@
 /      ff_req_grant(), ff_rel_grant(), ff_del_syncobj() and ff_cre_syncobj()
 /      function, must be added to the project. Samples are available in
 /      option/syscall.c.
+/   2: Same as 1 but the grant is released while file data is transferred by
+/      f_read() and f_write(), so that other tasks can access the volume during
+/      the transfer. The disk I/O functions must accept concurrent calls to the
+/      same drive. f_mount() waits for the transfers in progress on the volume to
+/      end before it is unmounted, and the transfers ended on a dismounted volume
+/      fail with FR_INVALID_OBJECT. The wait blocks a tick at a time with
+/      ff_wait_tick(), which must be added too, and f_mount() fails with FR_TIMEOUT
+/      after FF_FS_TIMEOUT ticks. A transfer that cannot get the grant back fails
+/      with FR_TIMEOUT and keeps the volume from being unmounted until the next
+/      call with its file object. This cannot be used with FF_FS_TINY = 1.
 /
 /  The FF_FS_TIMEOUT defines timeout period in unit of time tick.
 /  The FF_SYNC_t defines O/S dependent sync object type. e.g. HANDLE, ID, OS_EVENT*,
-/  SemaphoreHandle_t and etc. A header file for O/S definitions needs to be
-/  included somewhere in the scope of ff.h. */
+/  SemaphoreHandle_t, pthread_mutex_t* and etc. A header file for O/S definitions
+/  needs to be included somewhere in the scope of ff.h. */
 
 /* #include <windows.h>	// O/S definitions  */
 
@@ -13,14 +13,12 @@
 
 DWORD get_fattime (void)
 {
-    struct tm y2ktime;
-
     time_t timer;
 
     time(&timer);
-    localtime_r( &timer, &y2ktime );
 
-    return ( (DWORD)system_fatfs( &y2ktime ) );
+    /* cached, the calendar is only broken down when the local hour changes */
+    return ( (DWORD)system_fatfs_cached( &timer ) );
 }
 
 #else
@@ -68,6 +66,10 @@ void ff_memfree (
 #if FF_FS_REENTRANT	/* Mutal exclusion */
 
 #include <lib/yaz180/FreeRTOS.h>
+//#include <pthread.h>	/* POSIX threads */
+//#include <stdlib.h>	/* malloc(), free() for the POSIX threads sample */
+//#include <time.h>
+//#include <unistd.h>	/* usleep() for the POSIX threads sample */
 
 /*------------------------------------------------------------------------*/
 /* Create a Synchronization Object
@@ -105,6 +107,11 @@ int ff_cre_syncobj (	/* 1:Function succeeded, 0:Could not create the sync object
 
 	/* CMSIS-RTOS */
 //	*sobj = osMutexCreate(Mutex + vol);
+//	return (int)(*sobj != NULL);
+
+	/* POSIX threads (FF_SYNC_t = pthread_mutex_t*) */
+//	*sobj = malloc(sizeof (pthread_mutex_t));
+//	if (*sobj && pthread_mutex_init(*sobj, NULL) != 0) { free(*sobj); *sobj = NULL; }
 //	return (int)(*sobj != NULL);
 }
 
@@ -138,6 +145,11 @@ int ff_del_syncobj (	/* 1:Function succeeded, 0:Could not delete due to an error
 
 	/* CMSIS-RTOS */
 //	return (int)(osMutexDelete(sobj) == osOK);
+
+	/* POSIX threads */
+//	pthread_mutex_destroy(sobj);
+//	free(sobj);
+//	return 1;
 }
 
 
@@ -168,6 +180,14 @@ int ff_req_grant (	/* 1:Got a grant to access the volume, 0:Could not get a gran
 
 	/* CMSIS-RTOS */
 //	return (int)(osMutexWait(sobj, FF_FS_TIMEOUT) == osOK);
+
+	/* POSIX threads (FF_FS_TIMEOUT in ms) */
+//	struct timespec ts;
+//	clock_gettime(CLOCK_REALTIME, &ts);
+//	ts.tv_sec += FF_FS_TIMEOUT / 1000;
+//	ts.tv_nsec += (FF_FS_TIMEOUT % 1000) * 1000000L;
+//	if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+//	return (int)(pthread_mutex_timedlock(sobj, &ts) == 0);
 }
 
 
@@ -195,7 +215,42 @@ void ff_rel_grant (
 
 	/* CMSIS-RTOS */
 //	osMutexRelease(sobj);
+
+	/* POSIX threads */
+//	pthread_mutex_unlock(sobj);
 }
 
+
+#if FF_FS_REENTRANT == 2
+/*------------------------------------------------------------------------*/
+/* Wait for a Time Tick                                                   */
+/*------------------------------------------------------------------------*/
+/* This function is called in f_mount() function while it waits for the
+/  data transfers in progress on the volume to end. It needs to block the
+/  task for a time tick so that the tasks of lower priority can run.
+*/
+
+void ff_wait_tick (void)
+{
+	/* Win32 */
+//	Sleep(1);
+
+	/* uITRON */
+//	dly_tsk(1);
+
+	/* uC/OS-II */
+//	OSTimeDly(1);
+
+	/* FreeRTOS */
+	vTaskDelay(1);
+
+	/* CMSIS-RTOS */
+//	osDelay(1);
+
+	/* POSIX threads (a tick is 1 ms) */
+//	usleep(1000);
+}
+#endif
+
 #endif
 
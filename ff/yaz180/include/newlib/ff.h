@@ -117,10 +117,29 @@ typedef struct {
 #endif
 #if FF_FS_REENTRANT
     FF_SYNC_t    sobj;      /* Identifier of sync object */
+#if FF_FS_REENTRANT == 2
+    UINT    n_xfer;         /* Number of file data transfers running without the grant */
+#endif
+#endif
+#if FF_FS_STCACHE
+    WORD    st_cnt;         /* Number of validations left to use the cached drive status */
+#endif
+#if FF_USE_ASYNC
+    void*   as_obj;         /* Object whose asynchronous transfer is in flight on the drive (0:none) */
 #endif
 #if !FF_FS_READONLY
     DWORD   last_clst;      /* Last allocated cluster */
     DWORD   free_clst;      /* Number of free clusters */
+    DWORD   fat_chg;        /* Number of changes made to the FAT (allocation bitmap at exFAT) */
+#if FF_FS_RECLAIM
+    DWORD   rcl_clst[FF_FS_RECLAIM];    /* Top clusters of the chains pending to be removed (0:empty) */
+    DWORD   rcl_ncl[FF_FS_RECLAIM];        /* Number of clusters in each pending chain (0xFFFFFFFF:not counted yet) */
+#endif
+#if FF_APPEND_CACHE
+    DWORD   ac_ent[FF_APPEND_CACHE][3]; /* Append cache {top cluster, last cluster, number of clusters} of the recent chains */
+    DWORD   ac_hit;         /* Number of append cache hits */
+    DWORD   ac_miss;        /* Number of append cache misses */
+#endif
 #endif
 #if FF_FS_RPATH
     DWORD   cdir;           /* Current directory start cluster (0:root) */
@@ -150,6 +169,9 @@ typedef struct {
     BYTE    stat;           /* Object chain status (b1-0: =0:not contiguous, =2:contiguous, =3:flagmented in this session, b2:sub-directory stretched) */
     DWORD   sclust;         /* Object data start cluster (0:no cluster or root directory) */
     FSIZE_t objsize;        /* Object size (valid when sclust != 0) */
+#if FF_FS_CONTIG
+    DWORD   n_lead;         /* Number of clusters known to be contiguous from top of the chain (valid at file object) */
+#endif
 #if FF_FS_EXFAT
     DWORD   n_cont;         /* Size of first fragment - 1 (valid when stat == 3) */
     DWORD   n_frag;         /* Size of last fragment needs to be written to FAT (valid when not zero) */
@@ -160,6 +182,9 @@ typedef struct {
 #if FF_FS_LOCK
     UINT    lockid;         /* File lock ID origin from 1 (index of file semaphore table Files[]) */
 #endif
+#if FF_FS_REENTRANT == 2
+    BYTE    xfer;           /* Transfer left counted in n_xfer by a grant timeout (0:none) */
+#endif
 } FFOBJID;
 
 
@@ -175,10 +200,27 @@ typedef struct {
 #if !FF_FS_READONLY
     DWORD   dir_sect;       /* Sector number containing the directory entry (not used at exFAT) */
     BYTE*   dir_ptr;        /* Pointer to the directory entry in the win[] (not used at exFAT) */
+#if FF_USE_DATASYNC
+    DWORD   dir_sclust;     /* Start cluster recorded in the directory entry */
+    FSIZE_t dir_size;       /* File size recorded in the directory entry */
+#endif
 #endif
 #if FF_USE_FASTSEEK
     DWORD*  cltbl;          /* Pointer to the cluster link map table (nulled on open, set by application) */
 #endif
+#if FF_SEEK_INDEX
+    BYTE    ck_shift;       /* Interval of the seek checkpoints (2^ck_shift clusters) */
+    BYTE    ck_n;           /* Number of valid seek checkpoints */
+    DWORD   ck_clst[FF_SEEK_INDEX]; /* Seek checkpoints (cluster# at every interval from top of the file) */
+#endif
+#if FF_USE_ASYNC
+    BYTE    as_op;          /* Asynchronous transfer in progress (0:None, 1:Read, 2:Write) */
+    UINT    as_cnt;         /* Number of sectors in flight (0:None) */
+    DWORD   as_sect;        /* Start sector in flight */
+    BYTE*   as_buf;         /* Pointer to the data buffer of the transfer */
+    UINT    as_btx;         /* Number of bytes left to transfer */
+    UINT*   as_bx;          /* Pointer to the byte counter of the caller */
+#endif
 #if !FF_FS_TINY
     BYTE    buf[FF_MAX_SS]; /* File private data read/write window */
 #endif
@@ -219,6 +261,36 @@ typedef struct {
 } FILINFO;
 
 
+/* File I/O segment structure (FFIOVEC) */
+
+typedef struct {
+    void*   buf;            /* Pointer to the segment data */
+    UINT    len;            /* Number of bytes in the segment */
+} FFIOVEC;
+
+
+/* Resumable operation context (FFSTEP) */
+
+typedef struct {
+    const BYTE* buf;        /* Pointer to the data left to be written (f_write_step) */
+    UINT    btx;            /* Number of bytes left to be written (f_write_step) */
+    UINT    bx;             /* Number of bytes written (f_write_step) */
+    DWORD   clst;           /* Next cluster to be checked, 0 to start (f_getfree_step) */
+    DWORD   nfree;          /* Number of free clusters found (f_getfree_step) */
+    DWORD   fchg;           /* FAT change count at the start of the scan (f_getfree_step) */
+    WORD    id;             /* Mount ID of the volume at the start of the scan (f_getfree_step) */
+} FFSTEP;
+
+
+/* File extent (FFEXTENT) */
+
+typedef struct {
+    FSIZE_t ofs;            /* File offset of the run */
+    DWORD   sect;           /* Physical sector of the run */
+    DWORD   nsect;          /* Number of sectors in the run */
+} FFEXTENT;
+
+
 /* File function return code (FRESULT) */
 
 typedef enum {
@@ -256,12 +328,34 @@ __OPROTO(,,FRESULT,,f_close,FIL* fp)
 __OPROTO(,,FRESULT,,f_read,FIL* fp,void* buff,UINT btr,UINT* br)
          //FRESULT f_write (FIL* fp,const void* buff,UINT btw,UINT* bw);    /* Write data to the file */
 __OPROTO(,,FRESULT,,f_write,FIL* fp,const void* buff,UINT btw,UINT* bw)
+         //FRESULT f_readv (FIL* fp,const FFIOVEC* iov,UINT niov,UINT* br); /* Read data from the file into segments */
+__OPROTO(,,FRESULT,,f_readv,FIL* fp,const FFIOVEC* iov,UINT niov,UINT* br)
+         //FRESULT f_peek (FIL* fp,const BYTE** ptr,UINT* len);            /* Get pointer to the data at the file pointer */
+__OPROTO(,,FRESULT,,f_peek,FIL* fp,const BYTE** ptr,UINT* len)
+         //FRESULT f_consume (FIL* fp,UINT n);                              /* Move the file pointer over the peeked data */
+__OPROTO(,,FRESULT,,f_consume,FIL* fp,UINT n)
+         //FRESULT f_writev (FIL* fp,const FFIOVEC* iov,UINT niov,UINT* bw);    /* Write data in segments to the file */
+__OPROTO(,,FRESULT,,f_writev,FIL* fp,const FFIOVEC* iov,UINT niov,UINT* bw)
+         //FRESULT f_read_async (FIL* fp,void* buff,UINT btr,UINT* br);     /* Start reading data from the file */
+__OPROTO(,,FRESULT,,f_read_async,FIL* fp,void* buff,UINT btr,UINT* br)
+         //FRESULT f_write_async (FIL* fp,const void* buff,UINT btw,UINT* bw);  /* Start writing data to the file */
+__OPROTO(,,FRESULT,,f_write_async,FIL* fp,const void* buff,UINT btw,UINT* bw)
+         //FRESULT f_write_step (FIL* fp,FFSTEP* st,UINT nsect);           /* Write data to the file in steps */
+__OPROTO(,,FRESULT,,f_write_step,FIL* fp,FFSTEP* st,UINT nsect)
+         //FRESULT f_async_poll (FIL* fp);                                  /* Advance the asynchronous transfer of the file */
+__OPROTO(,,FRESULT,,f_async_poll,FIL* fp)
          //FRESULT f_lseek (FIL* fp,FSIZE_t ofs);                           /* Move file pointer of the file object */
 __OPROTO(,,FRESULT,,f_lseek,FIL* fp,FSIZE_t ofs)
+         //FRESULT f_getextents (FIL* fp,FFEXTENT* ext,UINT n,UINT* count); /* Get physical extents of the file */
+__OPROTO(,,FRESULT,,f_getextents,FIL* fp,FFEXTENT* ext,UINT n,UINT* count)
          //FRESULT f_truncate (FIL* fp);                                    /* Truncate the file */
 __OPROTO(,,FRESULT,,f_truncate,FIL* fp)
          //FRESULT f_sync (FIL* fp);                                        /* Flush cached data of the writing file */
 __OPROTO(,,FRESULT,,f_sync,FIL* fp)
+         //FRESULT f_datasync (FIL* fp);                                    /* Flush cached data of the file without updating the directory entry */
+__OPROTO(,,FRESULT,,f_datasync,FIL* fp)
+         //FRESULT f_sync_many (FIL* const fp[],UINT n);                   /* Flush cached data of the writing files on a volume */
+__OPROTO(,,FRESULT,,f_sync_many,FIL* const fp[],UINT n)
          //FRESULT f_opendir (DIR* dp,const TCHAR* path);                   /* Open a directory */
 __OPROTO(,,FRESULT,,f_opendir,DIR* dp,const TCHAR* path)
          //FRESULT f_closedir (DIR* dp);                                    /* Close an open directory */
@@ -278,6 +372,8 @@ __OPROTO(,,FRESULT,,f_mkdir,const TCHAR* path)
 __OPROTO(,,FRESULT,,f_unlink,const TCHAR* path)
          //FRESULT f_rename (const TCHAR* path_old,const TCHAR* path_new);  /* Rename/Move a file or directory */
 __OPROTO(,,FRESULT,,f_rename,const TCHAR* path_old,const TCHAR* path_new)
+         //FRESULT f_copy (const TCHAR* path_src,const TCHAR* path_dst,void* work,UINT len); /* Copy a file */
+__OPROTO(,,FRESULT,,f_copy,const TCHAR* path_src,const TCHAR* path_dst,void* work,UINT len)
          //FRESULT f_stat (const TCHAR* path,FILINFO* fno);                 /* Get file status */
 __OPROTO(,,FRESULT,,f_stat,const TCHAR* path,FILINFO* fno)
          //FRESULT f_chmod (const TCHAR* path,BYTE attr,BYTE mask);         /* Change attribute of a file/dir */
@@ -292,20 +388,30 @@ __OPROTO(,,FRESULT,,f_chdrive,const TCHAR* path)
 __OPROTO(,,FRESULT,,f_getcwd,TCHAR* buff,UINT len)
          //FRESULT f_getfree (const TCHAR* path,DWORD* nclst,FATFS** fatfs);    /* Get number of free clusters on the drive */
 __OPROTO(,,FRESULT,,f_getfree,const TCHAR* path,DWORD* nclst,FATFS** fatfs)
+         //FRESULT f_getfree_step (const TCHAR* path,FFSTEP* st,UINT nsect,DWORD* nclst); /* Get number of free clusters on the drive in steps */
+__OPROTO(,,FRESULT,,f_getfree_step,const TCHAR* path,FFSTEP* st,UINT nsect,DWORD* nclst)
          //FRESULT f_getlabel (const TCHAR* path,TCHAR* label,DWORD* vsn);  /* Get volume label */
 __OPROTO(,,FRESULT,,f_getlabel,const TCHAR* path,TCHAR* label,DWORD* vsn)
          //FRESULT f_setlabel (const TCHAR* label);                         /* Set volume label */
 __OPROTO(,,FRESULT,,f_setlabel,const TCHAR* label)
          //FRESULT f_forward (FIL* fp,UINT(*func)(const BYTE*,UINT),UINT btf,UINT* bf); /* Forward data to the stream */
 __OPROTO(,,FRESULT,,f_forward,FIL* fp,UINT(*func)(const BYTE*,UINT),UINT btf,UINT* bf)
+         //FRESULT f_forward_buf (FIL* fp,UINT(*func)(const BYTE*,UINT),UINT btf,UINT* bf,BYTE* buff,UINT bsize); /* Forward data to the stream in multi-sector chunks */
+__OPROTO(,,FRESULT,,f_forward_buf,FIL* fp,UINT(*func)(const BYTE*,UINT),UINT btf,UINT* bf,BYTE* buff,UINT bsize)
+         //FRESULT f_load (const TCHAR* path,void* dst,UINT maxlen,UINT* len); /* Load a file into memory */
+__OPROTO(,,FRESULT,,f_load,const TCHAR* path,void* dst,UINT maxlen,UINT* len)
          //FRESULT f_expand (FIL* fp,FSIZE_t szf,BYTE opt);                 /* Allocate a contiguous block to the file */
 __OPROTO(,,FRESULT,,f_expand,FIL* fp,FSIZE_t szf,BYTE opt)
+         //FRESULT f_reclaim_step (const TCHAR* path,DWORD budget,UINT* npend);    /* Free a slice of the removed cluster chains */
+__OPROTO(,,FRESULT,,f_reclaim_step,const TCHAR* path,DWORD budget,UINT* npend)
          //FRESULT f_mount (FATFS* fs,const TCHAR* path,BYTE opt);          /* Mount/Unmount a logical drive */
 __OPROTO(,,FRESULT,,f_mount,FATFS* fs,const TCHAR* path,BYTE opt)
          //FRESULT f_mkfs (const TCHAR* path,BYTE opt,DWORD au,void* work,UINT len);    /* Create a FAT volume */
 __OPROTO(,,FRESULT,,f_mkfs,const TCHAR* path,BYTE opt,DWORD au,void* work,UINT len)
          //FRESULT f_fdisk (BYTE pdrv,const DWORD* szt,void* work);         /* Divide a physical drive into some partitions */
 __OPROTO(,,FRESULT,,f_fdisk,BYTE pdrv,const DWORD* szt,void* work)
+         //FRESULT f_media_changed (BYTE pdrv);                            /* Notify media change on a physical drive */
+__OPROTO(,,FRESULT,,f_media_changed,BYTE pdrv)
          //FRESULT f_setcp (WORD cp);                                       /* Set current code page */
 __OPROTO(,,FRESULT,,f_setcp,WORD cp)
 
@@ -323,6 +429,7 @@ __OPROTO(,,TCHAR,*,f_gets,TCHAR* buff,int len,FIL* fp)
 #define f_error(fp) ((fp)->err)
 #define f_tell(fp) ((fp)->fptr)
 #define f_size(fp) ((fp)->obj.objsize)
+#define f_async_busy(fp) ((fp)->as_op)
 #define f_rewind(fp) f_lseek((fp), 0)
 #define f_rewinddir(dp) f_readdir((dp), 0)
 #define f_rmdir(path) f_unlink(path)
@@ -0,0 +1,107 @@
+/*
+ * (C)2012 Michael Duane Rice All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer. Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions
+ * and the following disclaimer in the documentation and/or other materials
+ * provided with the distribution. Neither the name of the copyright holders
+ * nor the names of contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+/*
+    Offset of the monotonic clock from the system time, in seconds and 1/256 second.
+    Accumulated by set_system_time() and set_system_time_basic(), so that the monotonic clock
+    never steps.
+
+    The clock reading shared by clock_gettime() and clock_gettime_basic(), which differ only in
+    the system time they are given. The snapshot is taken without disabling interrupts. The
+    seconds are read before and after the fraction, and the read is repeated if the system tick
+    has carried into the seconds (or the system time has been set) in between.
+
+    CLOCK_MONOTONIC adds the offset, so it advances steadily from the time the system clock
+    was started.
+*/
+
+#include "time.h"
+
+uint32_t           __clock_offset;
+uint8_t            __clock_offset_fraction;
+
+void
+__clock_offset_step(time_t system, uint8_t fraction, time_t timestamp)
+{
+    /* carry the step into the monotonic clock offset, so that clock does not move */
+    if ((uint8_t)(__clock_offset_fraction + fraction) < __clock_offset_fraction)
+        __clock_offset++;
+    __clock_offset_fraction += fraction;
+    __clock_offset += system - timestamp;
+}
+
+static time_t
+clock_snapshot(clockid_t clock_id, const time_t * system, const uint8_t * fraction, uint8_t * frac_out)
+{
+    time_t          sec, off;
+    uint8_t         frac, offf;
+
+    do {
+        sec = *(volatile time_t *)system;
+        frac = *(volatile uint8_t *)fraction;
+        off = *(volatile uint32_t *)&__clock_offset;
+        offf = *(volatile uint8_t *)&__clock_offset_fraction;
+    } while (sec != *(volatile time_t *)system || off != *(volatile uint32_t *)&__clock_offset);
+
+    if (clock_id == CLOCK_MONOTONIC) {
+        sec += off;
+        if ((uint8_t)(frac + offf) < frac)
+            sec++;
+        frac += offf;
+    }
+
+    *frac_out = frac;
+    return sec;
+}
+
+int8_t
+__clock_gettime(clockid_t clock_id, struct timespec * tp, const time_t * system, const uint8_t * fraction)
+{
+    uint8_t         frac;
+
+    if (clock_id > CLOCK_MONOTONIC)
+        return -1;
+
+    tp->tv_sec = clock_snapshot(clock_id, system, fraction, &frac);
+    tp->tv_nsec = frac * 3906250UL;
+    return 0;
+}
+
+uint32_t
+__clock_ticks(const time_t * system, const uint8_t * fraction)
+{
+    uint8_t         frac;
+    uint32_t        ret;
+
+    ret = clock_snapshot(CLOCK_MONOTONIC, system, fraction, &frac);
+    ret <<= 8;
+    ret |= frac;
+    return ret;
+}
@@ -0,0 +1,100 @@
+/*
+ * (C)2012 Michael Duane Rice All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer. Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions
+ * and the following disclaimer in the documentation and/or other materials
+ * provided with the distribution. Neither the name of the copyright holders
+ * nor the names of contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+/*
+    Convert a FAT file system date and time directly into a Y2K time stamp.
+
+    The fields are combined arithmetically, using a table of cumulative days before each month,
+    without building a struct tm or calling mktime(). FAT years run from 1980, so stamps before
+    the Y2K epoch (including the all zero 'no time stamp' value) and invalid months return
+    (time_t)-1, as zero is the valid stamp 2000-01-01 00:00:00.
+
+    fatfs_mk_gmtime() takes the stamp as UTC. fatfs_mktime() takes it as Local time, as FatFs
+    writes it, and removes the time zone and any Daylight Saving offset.
+*/
+
+#include "time.h"
+
+extern int32_t     __utc_offset;
+
+extern int16_t      (*__dst_ptr) (const time_t *, int32_t *);
+
+static const uint16_t fatfs_cumdays[] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+time_t
+fatfs_mk_gmtime(uint16_t fsdate, uint16_t fstime)
+{
+    uint32_t        days;
+    uint8_t         year, mon;
+
+    year = (uint8_t)(fsdate >> 9);
+    mon = (uint8_t)(fsdate >> 5) & 0x0F;
+
+    if (year < 20 || mon < 1 || mon > 12)
+        return (time_t)-1;
+    year -= 20;
+
+    /* days to the start of the year, 2000 is a leap year and 2100 is not */
+    days = 365UL * year + (uint8_t)(year + 3) / 4;
+    if (year > 100)
+        days--;
+
+    days += fatfs_cumdays[mon - 1];
+    if (mon > 2 && (year & 3) == 0 && year != 100)
+        days++;
+
+    days += (fsdate & 0x1F) - 1;
+
+    return days * ONE_DAY
+           + (fstime >> 11) * (uint32_t)ONE_HOUR
+           + ((fstime >> 5) & 0x3F) * 60U
+           + ((fstime & 0x1F) << 1);
+}
+
+time_t
+fatfs_mktime(uint16_t fsdate, uint16_t fstime)
+{
+    time_t          ret;
+    int16_t         dst;
+
+    ret = fatfs_mk_gmtime(fsdate, fstime);
+    if (ret == (time_t)-1)
+        return ret;
+
+    if (__dst_ptr) {
+        dst = __dst_ptr(&ret, &__utc_offset);
+        if (dst > 0)
+            ret -= dst;
+    }
+
+    return ret - __utc_offset;
+}
@@ -0,0 +1,74 @@
+/*
+ * (C)2012 Michael Duane Rice All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer. Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions
+ * and the following disclaimer in the documentation and/or other materials
+ * provided with the distribution. Neither the name of the copyright holders
+ * nor the names of contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+/*
+    Convert an array of FAT file system time stamps, packed as returned by system_fatfs()
+    (date in the upper 16 bits, time in the lower), into Y2K time stamps expressed as UTC.
+
+    Intended for whole directory listings. The stamps are taken as Local time, as fatfs_mktime(),
+    but the Daylight Saving function is consulted only when the date or hour differs from the
+    previous entry.
+*/
+
+#include "time.h"
+
+extern int32_t     __utc_offset;
+
+extern int16_t      (*__dst_ptr) (const time_t *, int32_t *);
+
+void
+fatfs_mktime_batch(const uint32_t * fattime, time_t * timer, uint16_t count)
+{
+    time_t          t;
+    uint32_t        hour, lasthour;
+    int16_t         dst;
+
+    dst = 0;
+    lasthour = 0;
+
+    while (count--) {
+        t = fatfs_mk_gmtime((uint16_t)(*fattime >> 16), (uint16_t)*fattime);
+
+        if (t != (time_t)-1) {
+            /* date and hour fields, which bound any Daylight Saving change */
+            hour = *fattime & 0xFFFFF800UL;
+            if (__dst_ptr && hour != lasthour) {
+                dst = __dst_ptr(&t, &__utc_offset);
+                if (dst < 0)
+                    dst = 0;
+                lasthour = hour;
+            }
+            t -= dst + __utc_offset;
+        }
+
+        *timer++ = t;
+        fattime++;
+    }
+}
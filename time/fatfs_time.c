@@ -87,13 +87,20 @@ system_fatfs(const struct tm * timeptr)
 uint32_t
 fatfs_system( uint16_t fsdate, uint16_t fstime, struct tm * timeptr)
 {
-    timeptr->tm_year =          ((fsdate >> 9) & 0x007F) + 80;
-    timeptr->tm_mon =  ((uint8_t)(fsdate >> 5 ) & 0x0F) - 1;
-    timeptr->tm_mday =  (uint8_t) fsdate & 0x1F;
-
-    timeptr->tm_hour =  (uint8_t)(fstime >> 11) & 0x1F;
-    timeptr->tm_min =   (uint8_t)(fstime >> 5) & 0x3F;
-    timeptr->tm_sec =  ((uint8_t) fstime & 0x001F) << 1;
-return mktime( timeptr );
+    time_t          ret;
+
+    /* compile the stamp directly, then break it down once, rather than via mktime() */
+    ret = fatfs_mktime(fsdate, fstime);
+    if (ret == (time_t)-1) {
+        /* no valid stamp, return an all zero struct tm rather than break down the error value */
+        timeptr->tm_sec = timeptr->tm_min = timeptr->tm_hour = 0;
+        timeptr->tm_mday = timeptr->tm_wday = timeptr->tm_mon = 0;
+        timeptr->tm_year = timeptr->tm_yday = 0;
+        timeptr->tm_isdst = 0;
+        return ret;
+    }
+    localtime_r(&ret, timeptr);
+
+    return ret;
 }
 
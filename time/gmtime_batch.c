@@ -0,0 +1,70 @@
+/*
+ * (C)2012 Michael Duane Rice All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer. Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions
+ * and the following disclaimer in the documentation and/or other materials
+ * provided with the distribution. Neither the name of the copyright holders
+ * nor the names of contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+/*
+    Break down an array of time stamps into an array of struct tm, expressed as UTC.
+
+    Log and directory time stamps tend to arrive in order and close together. The calendar
+    date of the previous element is kept, and when the next time stamp falls within the same
+    day only the hour, minute and second are derived; the date elements are copied. This avoids
+    the costly leap cycle arithmetic of gmtime_r() for all but the first stamp of each day.
+*/
+
+#include "time.h"
+
+void
+gmtime_batch(const time_t * timer, struct tm * timeptr, uint16_t count)
+{
+    time_t          daystart;
+    uint32_t        fract;
+    uint16_t        n;
+    struct tm      *last;
+
+    last = NULL;
+    daystart = 0;
+
+    while (count--) {
+        fract = *timer - daystart;
+
+        if (last && *timer >= daystart && fract < ONE_DAY) {
+            *timeptr = *last;
+            n = (uint16_t)(fract / 60);
+            timeptr->tm_sec = (uint8_t)(fract - n * 60UL);
+            timeptr->tm_min = (uint8_t)(n % 60);
+            timeptr->tm_hour = (uint8_t)(n / 60);
+        } else {
+            gmtime_r(timer, timeptr);
+            daystart = *timer - (timeptr->tm_hour * (uint32_t)ONE_HOUR + timeptr->tm_min * 60U + timeptr->tm_sec);
+        }
+
+        last = timeptr++;
+        timer++;
+    }
+}
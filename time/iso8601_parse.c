@@ -0,0 +1,158 @@
+/*
+ * (C)2012 Michael Duane Rice All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer. Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions
+ * and the following disclaimer in the documentation and/or other materials
+ * provided with the distribution. Neither the name of the copyright holders
+ * nor the names of contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+/*
+    Parse an ISO 8601 date and time string directly into a Y2K time stamp.
+
+    Accepted forms are the extended and basic calendar formats, with an optional time of day,
+    optional fraction of a second (ignored) and optional UTC designator or offset...
+
+        2013-03-23
+        2013-03-23T01:03:52
+        2013-03-23 01:03:52.250Z
+        20130323T010352+1000
+        2013-03-23T01:03-05:00
+
+    The space separator matches the output of isotime(). A time without a designator is taken
+    as UTC. Every field is range checked, including the day against the length of the month,
+    and the result must lie within the Y2K epoch.
+
+    No struct tm normalisation is performed; the fields are compiled once by mk_gmtime() and the
+    offset applied. Returns a pointer to the first character not consumed, so that a buffer of
+    records may be walked in a loop, or NULL if the string is not a valid time stamp.
+*/
+
+#include "time.h"
+
+static const char *
+iso_num(const char *s, uint8_t width, uint8_t * val)
+{
+    uint8_t         n, c;
+
+    n = 0;
+    do {
+        c = *s++ - '0';
+        if (c > 9)
+            return NULL;
+        n = n * 10 + c;
+    } while (--width);
+
+    *val = n;
+    return s;
+}
+
+char *
+iso8601_parse(const char *buf, time_t * timer)
+{
+    struct tm       t;
+    time_t          ret;
+    int32_t         offset;
+    uint8_t         cc, yy, ext;
+    char            c;
+
+    /* date, the separators are optional but must be used consistently */
+    if ((buf = iso_num(buf, 2, &cc)) == NULL || (buf = iso_num(buf, 2, &yy)) == NULL)
+        return NULL;
+    if (cc < 20 || cc > 21 || (cc == 21 && yy > 35))
+        return NULL;
+    t.tm_year = cc * 100 + yy - 1900;
+
+    ext = (*buf == '-');
+    buf += ext;
+    if ((buf = iso_num(buf, 2, &t.tm_mon)) == NULL)
+        return NULL;
+    if (ext && *buf++ != '-')
+        return NULL;
+    if ((buf = iso_num(buf, 2, &t.tm_mday)) == NULL)
+        return NULL;
+
+    if (t.tm_mon < 1 || t.tm_mon > 12)
+        return NULL;
+    if (t.tm_mday < 1 || t.tm_mday > month_length(t.tm_year + 1900, t.tm_mon))
+        return NULL;
+    t.tm_mon--;
+
+    /* time of day */
+    t.tm_hour = t.tm_min = t.tm_sec = 0;
+    c = *buf;
+    if ((c == 'T' || c == ' ') && (uint8_t)(buf[1] - '0') <= 9) {
+        if ((buf = iso_num(buf + 1, 2, &t.tm_hour)) == NULL)
+            return NULL;
+        ext = (*buf == ':');
+        buf += ext;
+        if ((buf = iso_num(buf, 2, &t.tm_min)) == NULL)
+            return NULL;
+        if (*buf == ':' || (!ext && (uint8_t)(*buf - '0') <= 9)) {
+            if (ext && *buf++ != ':')
+                return NULL;
+            if ((buf = iso_num(buf, 2, &t.tm_sec)) == NULL)
+                return NULL;
+            if (*buf == '.' || *buf == ',') {
+                if ((uint8_t)(*++buf - '0') > 9)
+                    return NULL;
+                do
+                    buf++;
+                while ((uint8_t)(*buf - '0') <= 9);
+            }
+        }
+        if (t.tm_hour > 23 || t.tm_min > 59 || t.tm_sec > 59)
+            return NULL;
+    }
+
+    ret = mk_gmtime(&t);
+
+    /* designator */
+    c = *buf;
+    if (c == 'Z') {
+        buf++;
+    } else if (c == '+' || c == '-') {
+        if ((buf = iso_num(buf + 1, 2, &cc)) == NULL)
+            return NULL;
+        yy = 0;
+        if (*buf == ':')
+            buf++;
+        if ((uint8_t)(*buf - '0') <= 9 && (buf = iso_num(buf, 2, &yy)) == NULL)
+            return NULL;
+        if (cc > 23 || yy > 59)
+            return NULL;
+
+        offset = cc * (int32_t)ONE_HOUR + yy * 60;
+        if (c == '+') {
+            if (ret < (time_t)offset)
+                return NULL;
+            ret -= offset;
+        } else {
+            ret += offset;
+        }
+    }
+
+    *timer = ret;
+    return (char *)buf;
+}
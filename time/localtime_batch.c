@@ -0,0 +1,88 @@
+/*
+ * (C)2012 Michael Duane Rice All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer. Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions
+ * and the following disclaimer in the documentation and/or other materials
+ * provided with the distribution. Neither the name of the copyright holders
+ * nor the names of contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+/*
+    Break down an array of time stamps into an array of struct tm, expressed as Local time.
+
+    As gmtime_batch(), the calendar date of the previous element is reused while the local
+    time stamps stay within the same day. The Daylight Saving function is consulted once per
+    hour of UTC rather than once per stamp, which is exact for any rule that changes only on
+    an hour boundary (as do the EU and USA rules).
+*/
+
+#include "time.h"
+
+extern int32_t     __utc_offset;
+
+extern int16_t      (*__dst_ptr) (const time_t *, int32_t *);
+
+void
+localtime_batch(const time_t * timer, struct tm * timeptr, uint16_t count)
+{
+    time_t          lt, daystart, hourstart;
+    uint32_t        fract;
+    uint16_t        n;
+    int16_t         dst;
+    struct tm      *last;
+
+    last = NULL;
+    daystart = hourstart = 0;
+    dst = -1;
+
+    while (count--) {
+
+        /* refresh the Daylight Saving state when the UTC hour changes */
+        if (__dst_ptr && (last == NULL || *timer < hourstart || *timer - hourstart >= ONE_HOUR)) {
+            dst = __dst_ptr(timer, &__utc_offset);
+            hourstart = *timer - *timer % ONE_HOUR;
+        }
+
+        lt = *timer + __utc_offset;
+        if (dst > 0)
+            lt += dst;
+
+        fract = lt - daystart;
+
+        if (last && lt >= daystart && fract < ONE_DAY) {
+            *timeptr = *last;
+            n = (uint16_t)(fract / 60);
+            timeptr->tm_sec = (uint8_t)(fract - n * 60UL);
+            timeptr->tm_min = (uint8_t)(n % 60);
+            timeptr->tm_hour = (uint8_t)(n / 60);
+        } else {
+            gmtime_r((const time_t *)&lt, timeptr);
+            daystart = lt - (timeptr->tm_hour * (uint32_t)ONE_HOUR + timeptr->tm_min * 60U + timeptr->tm_sec);
+        }
+        timeptr->tm_isdst = dst;
+
+        last = timeptr++;
+        timer++;
+    }
+}
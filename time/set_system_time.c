@@ -40,9 +40,13 @@
 extern uint8_t _system_time_fraction;
 extern time_t _system_time;
 
+extern void __clock_offset_step(time_t, uint8_t, time_t);
+
 void
 set_system_time(time_t timestamp) __critical
 {
+    __clock_offset_step(_system_time, _system_time_fraction, timestamp);
+
     _system_time = timestamp;
     _system_time_fraction = 0;
 }
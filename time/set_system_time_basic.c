@@ -40,9 +40,13 @@
 extern uint8_t _system_time_fraction_basic;
 extern time_t _system_time_basic;
 
+extern void __clock_offset_step(time_t, uint8_t, time_t);
+
 void
 set_system_time_basic(time_t timestamp) __critical
 {
+    __clock_offset_step(_system_time_basic, _system_time_fraction_basic, timestamp);
+
     _system_time_basic = timestamp;
     _system_time_fraction_basic = 0;
 }
@@ -0,0 +1,246 @@
+/*
+ * (C)2012 Michael Duane Rice All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer. Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions
+ * and the following disclaimer in the documentation and/or other materials
+ * provided with the distribution. Neither the name of the copyright holders
+ * nor the names of contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+/*
+    Parse a character string according to a format, filling in the elements of struct tm.
+    The inverse of strftime(), restricted to the 'C' locale and the conversions most often
+    needed to read back time stamps. No memory is allocated and stdio is not used.
+
+    Numeric fields are range checked as they are read. Elements of timeptr which are not named
+    by the format are left unchanged, and tm_wday and tm_yday are not derived from the date;
+    pass the result through mktime() or mk_gmtime() if they are needed.
+
+    Month and day names are matched, without regard to case, on their first three letters.
+    Any further letters of a full name are consumed.
+
+    Returns a pointer to the first character not consumed, or NULL if the string does not
+    match the format.
+*/
+
+#include "time.h"
+
+extern const char ascmonths[];
+extern const char ascdays[];
+
+static const char *
+strp_num(const char *s, uint8_t width, uint16_t min, uint16_t max, uint16_t * val)
+{
+    uint16_t        n;
+    uint8_t         c;
+
+    n = 0;
+    c = *s - '0';
+    if (c > 9)
+        return NULL;
+
+    do {
+        n = n * 10 + c;
+        c = *++s - '0';
+    } while (--width && c <= 9);
+
+    if (n < min || n > max)
+        return NULL;
+
+    *val = n;
+    return s;
+}
+
+static const char *
+strp_name(const char *s, const char *names, uint8_t count, uint16_t * val)
+{
+    uint8_t         i, j;
+
+    for (i = 0; i < count; i++, names += 3) {
+        for (j = 0; j < 3; j++) {
+            if ((s[j] | 0x20) != (names[j] | 0x20))
+                break;
+        }
+        if (j == 3) {
+            s += 3;
+            while ((uint8_t)((*s | 0x20) - 'a') < 26)
+                s++;
+            *val = i;
+            return s;
+        }
+    }
+    return NULL;
+}
+
+static uint8_t
+strp_space(char c)
+{
+    return c == ' ' || (uint8_t)(c - '\t') < 5;
+}
+
+char *
+strptime(const char *buf, const char *format, struct tm * timeptr)
+{
+    uint16_t        n;
+    int8_t          pm;
+    char            c;
+
+    pm = -1;
+
+    while ((c = *format++) != 0) {
+
+        if (strp_space(c)) {
+            while (strp_space(*buf))
+                buf++;
+            continue;
+        }
+
+        if (c != '%') {
+            if (*buf++ != c)
+                return NULL;
+            continue;
+        }
+
+        c = *format++;
+        if (c == 'E' || c == 'O')
+            c = *format++;
+
+        switch (c) {
+        case ('%'):
+            if (*buf++ != '%')
+                return NULL;
+            continue;
+
+        case ('n'):
+        case ('t'):
+            while (strp_space(*buf))
+                buf++;
+            continue;
+
+        case ('D'):
+            buf = strptime(buf, "%m/%d/%y", timeptr);
+            break;
+
+        case ('F'):
+            buf = strptime(buf, "%Y-%m-%d", timeptr);
+            break;
+
+        case ('R'):
+            buf = strptime(buf, "%H:%M", timeptr);
+            break;
+
+        case ('T'):
+            buf = strptime(buf, "%H:%M:%S", timeptr);
+            break;
+
+        case ('a'):
+        case ('A'):
+            buf = strp_name(buf, ascdays, 7, &n);
+            timeptr->tm_wday = n;
+            break;
+
+        case ('b'):
+        case ('B'):
+        case ('h'):
+            buf = strp_name(buf, ascmonths, 12, &n);
+            timeptr->tm_mon = n;
+            break;
+
+        case ('d'):
+        case ('e'):
+            while (*buf == ' ')
+                buf++;
+            buf = strp_num(buf, 2, 1, 31, &n);
+            timeptr->tm_mday = n;
+            break;
+
+        case ('H'):
+            buf = strp_num(buf, 2, 0, 23, &n);
+            timeptr->tm_hour = n;
+            break;
+
+        case ('I'):
+            buf = strp_num(buf, 2, 1, 12, &n);
+            timeptr->tm_hour = n % 12;
+            break;
+
+        case ('j'):
+            buf = strp_num(buf, 3, 1, 366, &n);
+            timeptr->tm_yday = n - 1;
+            break;
+
+        case ('m'):
+            buf = strp_num(buf, 2, 1, 12, &n);
+            timeptr->tm_mon = n - 1;
+            break;
+
+        case ('M'):
+            buf = strp_num(buf, 2, 0, 59, &n);
+            timeptr->tm_min = n;
+            break;
+
+        case ('p'):
+            c = *buf | 0x20;
+            if ((c != 'a' && c != 'p') || (buf[1] | 0x20) != 'm')
+                return NULL;
+            pm = (c == 'p');
+            buf += 2;
+            continue;
+
+        case ('S'):
+            buf = strp_num(buf, 2, 0, 59, &n);
+            timeptr->tm_sec = n;
+            break;
+
+        case ('w'):
+            buf = strp_num(buf, 1, 0, 6, &n);
+            timeptr->tm_wday = n;
+            break;
+
+        case ('y'):
+            buf = strp_num(buf, 2, 0, 99, &n);
+            if (n < 69)
+                n += 100;
+            timeptr->tm_year = n;
+            break;
+
+        case ('Y'):
+            buf = strp_num(buf, 4, 1900, 9999, &n);
+            timeptr->tm_year = n - 1900;
+            break;
+
+        default:
+            return NULL;
+        }
+
+        if (buf == NULL)
+            return NULL;
+    }
+
+    /* apply AM/PM once the hour is known, regardless of the order of %I and %p */
+    if (pm > 0 && timeptr->tm_hour < 12)
+        timeptr->tm_hour += 12;
+
+    return (char *)buf;
+}
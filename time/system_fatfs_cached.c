@@ -0,0 +1,95 @@
+/*
+ * (C)2012 Michael Duane Rice All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer. Redistributions in binary
+ * form must reproduce the above copyright notice, this list of conditions
+ * and the following disclaimer in the documentation and/or other materials
+ * provided with the distribution. Neither the name of the copyright holders
+ * nor the names of contributors may be used to endorse or promote products
+ * derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+/*
+    Return the FAT file system time stamp for the given Y2K time stamp, expressed as Local time,
+    as system_fatfs(localtime(timer)) would.
+
+    FatFs asks for the time on every directory entry it writes, and usually with the current
+    time. The last result is returned again for the same second. The local date and hour are
+    kept, and while the time stamp remains within that hour only the minute and second fields
+    are recomputed, so the calendar break down and the Daylight Saving function are needed
+    at most once an hour. The cache is refreshed early if the time zone or Daylight Saving
+    function is changed, or if the time stamp steps backwards.
+
+    Uses static storage, and so is not re-entrant.
+*/
+
+#include "time.h"
+
+extern int32_t     __utc_offset;
+
+extern int16_t      (*__dst_ptr) (const time_t *, int32_t *);
+
+uint32_t
+system_fatfs_cached(const time_t * timer)
+{
+    static time_t   last, hourstart, hourend;
+    static uint32_t fattime, hourtime;
+    static int32_t  offset;
+    static int16_t  (*dst_ptr) (const time_t *, int32_t *);
+
+    struct tm       tm;
+    time_t          lt;
+    uint16_t        s;
+    int16_t         dst;
+
+    if (*timer == last && fattime)
+        return fattime;
+
+    if (*timer < hourstart || *timer >= hourend || offset != __utc_offset || dst_ptr != __dst_ptr || !fattime) {
+
+        offset = __utc_offset;
+        dst_ptr = __dst_ptr;
+
+        dst = 0;
+        if (dst_ptr)
+            dst = dst_ptr(timer, &__utc_offset);
+
+        lt = *timer + __utc_offset;
+        if (dst > 0)
+            lt += dst;
+
+        gmtime_r((const time_t *)&lt, &tm);
+        hourtime = system_fatfs(&tm) & 0xFFFFF800UL;
+
+        /* valid to the end of the local hour, or of the UTC hour if that comes first */
+        hourstart = *timer - (tm.tm_min * 60U + tm.tm_sec);
+        hourend = *timer - *timer % ONE_HOUR + ONE_HOUR;
+        if (hourend - hourstart > ONE_HOUR)
+            hourend = hourstart + ONE_HOUR;
+    }
+
+    s = (uint16_t)(*timer - hourstart);
+    fattime = hourtime | (uint16_t)((s / 60) << 5) | (uint8_t)((s % 60) >> 1);
+    last = *timer;
+
+    return fattime;
+}
@@ -148,6 +148,57 @@ __OPROTO(,,time_t,,time,time_t *timer)
 //  int32_t     difftime(time_t time1, time_t time0);
 __OPROTO(,,int32_t,,difftime,time_t time1,time_t time0)
 
+    /**
+        Identifiers for the clocks read by clock_gettime().
+
+        CLOCK_REALTIME is the system time. CLOCK_MONOTONIC runs at the same rate, but is not
+        changed by set_system_time(), making it suitable for measuring intervals.
+    */
+    typedef     uint8_t clockid_t;
+
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
+    /** Resolution of the system time fraction, and of clock_ticks(), in ticks per second */
+#define CLOCK_TICKS_PER_SEC 256
+
+    /**
+        A time value with sub-second resolution, as returned by clock_gettime().
+        The resolution of tv_nsec is that of the system tick, 1/256 second.
+    */
+    struct timespec {
+        time_t           tv_sec;
+        uint32_t         tv_nsec;
+    };
+
+    /**
+        Read the clock given by clock_id into tp, with the resolution of the system tick.
+        The seconds and fraction are a consistent snapshot, taken without disabling interrupts.
+        Returns 0, or -1 if clock_id is not known.
+    */
+//  int8_t      clock_gettime_basic(clockid_t clock_id, struct timespec * tp);
+__OPROTO(,,int8_t,,clock_gettime_basic,clockid_t clock_id,struct timespec * tp)
+
+//  int8_t      clock_gettime(clockid_t clock_id, struct timespec * tp);
+__OPROTO(,,int8_t,,clock_gettime,clockid_t clock_id,struct timespec * tp)
+
+#define clock_gettime(a,b) clock_gettime_basic(a,b)
+
+    /**
+        Return the monotonic clock as a count of 1/256 second ticks. The count wraps after about
+        194 days, so only differences between two readings are meaningful.
+    */
+//  uint32_t    clock_ticks_basic(void);
+__OPROTO(,,uint32_t,,clock_ticks_basic,void)
+
+//  uint32_t    clock_ticks(void);
+__OPROTO(,,uint32_t,,clock_ticks,void)
+
+#define clock_ticks() clock_ticks_basic()
+
+    /** Return the ticks elapsed since an earlier reading of clock_ticks(). */
+#define clock_elapsed(since) (clock_ticks() - (since))
+
     /**
         The tm structure contains a representation of time 'broken down' into components of the
         Gregorian calendar.
@@ -239,6 +290,22 @@ __OPROTO(,,struct tm,*,localtime,const time_t * timer)
 //  void        localtime_r(const time_t * timer, struct tm * timeptr);
 __OPROTO(,,void,,localtime_r,const time_t * timer,struct tm * timeptr)
 
+    /**
+        Convert count time stamps from the array timer into the array timeptr, expressed as UTC.
+        The calendar date is reused while consecutive stamps fall on the same day, which makes this
+        much faster than calling gmtime_r() in a loop for sorted or clustered time stamps.
+    */
+//  void        gmtime_batch(const time_t * timer, struct tm * timeptr, uint16_t count);
+__OPROTO(,,void,,gmtime_batch,const time_t * timer,struct tm * timeptr,uint16_t count)
+
+    /**
+        Convert count time stamps from the array timer into the array timeptr, expressed as Local time.
+        As gmtime_batch(), and the Daylight Saving function is consulted once per hour rather than once
+        per time stamp.
+    */
+//  void        localtime_batch(const time_t * timer, struct tm * timeptr, uint16_t count);
+__OPROTO(,,void,,localtime_batch,const time_t * timer,struct tm * timeptr,uint16_t count)
+
     /**
     The asctime function converts the broken-down time of timeptr, into an ascii string in the form
 
@@ -288,6 +355,29 @@ __OPROTO(,,void,,isotime_r,const struct tm *,char *)
 //  size_t      strftime(char *s, size_t maxsize, const char *format, const struct tm * timeptr);
 __OPROTO(,,size_t,,strftime,char *s,size_t maxsize,const char *format,const struct tm * timeptr)
 
+    /**
+    Parse the string s according to format, storing the converted values in timeptr.
+    The conversions are those of strftime() which describe a field of struct tm, in the 'C' locale.
+    Numeric fields are range checked, and the elements of timeptr which are not named by format
+    are left unchanged.
+
+    Returns a pointer to the first character of s not consumed, or NULL if s does not match format.
+    */
+//  char        *strptime(const char *s, const char *format, struct tm * timeptr);
+__OPROTO(,,char,*,strptime,const char *s,const char *format,struct tm * timeptr)
+
+    /**
+    Parse an ISO 8601 calendar date and time, such as
+        \code2013-03-23T01:03:52+10:00\endcode
+    directly into a Y2K time stamp, without the normalisation performed by mktime(). A time
+    without a UTC designator or offset is taken as UTC.
+
+    Returns a pointer to the first character of s not consumed, or NULL if s is not a valid
+    time stamp within the range of time_t.
+    */
+//  char        *iso8601_parse(const char *s, time_t * timer);
+__OPROTO(,,char,*,iso8601_parse,const char *s,time_t * timer)
+
     /**
         Specify the Daylight Saving function.
 
@@ -463,12 +553,42 @@ __OPROTO(,,void,,iso_week_date_r,uint16_t year,uint16_t yday,struct week_date *)
 //  uint32_t    system_fatfs(const struct tm * timeptr);
 __OPROTO(,,uint32_t,,system_fatfs,const struct tm * timeptr)
 
+    /**
+        Convert a Y2K time stamp into a FAT file system time stamp, expressed as Local time.
+        The result is cached, so that repeated calls within the same second are a simple load and
+        the calendar is broken down at most once an hour. Suitable for use as get_fattime().
+    */
+//  uint32_t    system_fatfs_cached(const time_t * timer);
+__OPROTO(,,uint32_t,,system_fatfs_cached,const time_t * timer)
+
     /**
         Convert a FAT file system time stamp into a Y2K time stamp.
+        Returns (time_t)-1 and an all zero struct tm for stamps before the Y2K epoch.
     */
 //  uint32_t    fatfs_system(uint16_t fsdate, uint16_t fstime, struct tm * timeptr);
 __OPROTO(,,uint32_t,,fatfs_system,uint16_t fsdate,uint16_t fstime,struct tm * timeptr)
 
+    /**
+        Convert a FAT file system date and time, taken as UTC, directly into a Y2K time stamp.
+        Returns (time_t)-1 for stamps before the Y2K epoch or with an invalid month.
+    */
+//  time_t      fatfs_mk_gmtime(uint16_t fsdate, uint16_t fstime);
+__OPROTO(,,time_t,,fatfs_mk_gmtime,uint16_t fsdate,uint16_t fstime)
+
+    /**
+        Convert a FAT file system date and time, taken as Local time, directly into a Y2K time stamp.
+        Returns (time_t)-1 for stamps before the Y2K epoch or with an invalid month.
+    */
+//  time_t      fatfs_mktime(uint16_t fsdate, uint16_t fstime);
+__OPROTO(,,time_t,,fatfs_mktime,uint16_t fsdate,uint16_t fstime)
+
+    /**
+        Convert count FAT file system time stamps, packed with the date in the upper 16 bits,
+        taken as Local time, into Y2K time stamps. Intended for directory listings.
+    */
+//  void        fatfs_mktime_batch(const uint32_t * fattime, time_t * timer, uint16_t count);
+__OPROTO(,,void,,fatfs_mktime_batch,const uint32_t * fattime,time_t * timer,uint16_t count)
+
     /** One hour, expressed in seconds */
 #define ONE_HOUR 3600
 